@@ -12,3 +12,9 @@ wayland-scanner client-header < wayland-protocols/tablet-v2.xml > "src/wayland/p
 wayland-scanner private-code  < wayland-protocols/xdg-decoration-unstable-v1.xml > "src/wayland/protocols/xdg-decoration.c"
 wayland-scanner client-header < wayland-protocols/xdg-decoration-unstable-v1.xml > "src/wayland/protocols/xdg-decoration.h"
 
+
+wayland-scanner private-code  < wayland-protocols/viewporter.xml > "src/wayland/protocols/viewporter.c"
+wayland-scanner client-header < wayland-protocols/viewporter.xml > "src/wayland/protocols/viewporter.h"
+
+wayland-scanner private-code  < wayland-protocols/fractional-scale-v1.xml > "src/wayland/protocols/fractional-scale.c"
+wayland-scanner client-header < wayland-protocols/fractional-scale-v1.xml > "src/wayland/protocols/fractional-scale.h"
@@ -6,7 +6,8 @@ uintptr_t align(uintptr_t ptr, alignment_info_t info) {
         return ptr;
     }
 
-    return (ptr + (alignment - 1)) & ~(alignment - 1);
+    uintptr_t mask = (uintptr_t) alignment - 1; // @Note: widen first, otherwise ~mask is 32-bit and chops off the top of the pointer.
+    return (ptr + mask) & ~mask;
 }
 
 const alignment_info_t align16 = { 16 };
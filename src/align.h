@@ -7,6 +7,8 @@ typedef struct alignment_info_t {
 
 uintptr_t align(uintptr_t ptr, alignment_info_t info);
 
+#define alignment_of(type) ((alignment_info_t) { (u32) alignof(type) })
+
 extern const alignment_info_t align16;
 extern const alignment_info_t align8;
 extern const alignment_info_t align4;
@@ -8,6 +8,11 @@ extern "C" {
 
 #define static_array_size(x) (sizeof((x))/sizeof((x)[0]))
 
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#define clamp(x, a, b) (min(max(x, a), b))
+#define lerp(a, b, t) ((a) + ((b)-(a)) * (t))
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,264 @@
+#include "blend.h"
+#include "cpu.h"
+#include "span_fill.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLEND_X86 1
+#endif
+
+
+typedef struct {
+    void (*solid)(u32* data, u32 color, u8 alpha, u32 count);
+    void (*coverage)(u32* data, u32 color, const u8* coverage, u32 count);
+} blend_impl_t;
+
+
+//
+// @Note: round(x / 255) for x in [0, 255*255], no division.
+//
+static inline u32 div255(u32 x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+u32 blend_pixel(u32 background, u32 color, u8 alpha) {
+    u32 a  = alpha;
+    u32 ia = 255 - a;
+
+    u32 r = div255(((background >> 16) & 0xFF) * ia + ((color >> 16) & 0xFF) * a);
+    u32 g = div255(((background >> 8)  & 0xFF) * ia + ((color >> 8)  & 0xFF) * a);
+    u32 b = div255(((background >> 0)  & 0xFF) * ia + ((color >> 0)  & 0xFF) * a);
+
+    return (0xFFu << 24) | (r << 16) | (g << 8) | (b << 0);
+}
+
+static void blend_span_solid_scalar(u32* data, u32 color, u8 alpha, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        data[i] = blend_pixel(data[i], color, alpha);
+    }
+}
+
+static void blend_span_coverage_scalar(u32* data, u32 color, const u8* coverage, u32 count) {
+    u32 ca = color >> 24;
+
+    for (u32 i = 0; i < count; i++) {
+        u32 a = div255(coverage[i] * ca);
+        if (a == 0) continue;
+
+        data[i] = blend_pixel(data[i], color, (u8) a);
+    }
+}
+
+#ifdef BLEND_X86
+
+//
+// @Note: all of the vector paths work on 16-bit lanes: d*(255-a) + s*a + 128 fits into u16, then (x + (x >> 8)) >> 8 divides by 255.
+//
+
+__attribute__((target("sse2")))
+static inline __m128i blend_lanes_sse2(__m128i d, __m128i s, __m128i a) {
+    __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    __m128i x  = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(d, ia), _mm_mullo_epi16(s, a)), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i scale_lanes_sse2(__m128i a, __m128i scale) {
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(a, scale), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+static void blend_span_solid_sse2(u32* data, u32 color, u8 alpha, u32 count) {
+    __m128i zero   = _mm_setzero_si128();
+    __m128i opaque = _mm_set1_epi32((int) 0xFF000000u);
+    __m128i s      = _mm_unpacklo_epi8(_mm_set1_epi32((int) color), zero);
+    __m128i a      = _mm_set1_epi16(alpha);
+
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i d  = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i lo = blend_lanes_sse2(_mm_unpacklo_epi8(d, zero), s, a);
+        __m128i hi = blend_lanes_sse2(_mm_unpackhi_epi8(d, zero), s, a);
+
+        _mm_storeu_si128((__m128i*) (data + i), _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+
+    blend_span_solid_scalar(data + i, color, alpha, count - i);
+}
+
+__attribute__((target("sse2")))
+static void blend_span_coverage_sse2(u32* data, u32 color, const u8* coverage, u32 count) {
+    u32 ca    = color >> 24;
+    u32 solid = color | 0xFF000000u;
+
+    __m128i zero   = _mm_setzero_si128();
+    __m128i opaque = _mm_set1_epi32((int) 0xFF000000u);
+    __m128i s      = _mm_unpacklo_epi8(_mm_set1_epi32((int) color), zero);
+    __m128i scale  = _mm_set1_epi16((s16) ca);
+
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4) {
+        u32 c4;
+        memcpy(&c4, coverage + i, sizeof(c4));
+
+        if (c4 == 0) {
+            continue;
+        }
+
+        if (c4 == 0xFFFFFFFFu && ca == 255) {
+            _mm_storeu_si128((__m128i*) (data + i), _mm_set1_epi32((int) solid));
+            continue;
+        }
+
+        __m128i c = _mm_cvtsi32_si128((int) c4);
+        c = _mm_unpacklo_epi8(c, c);
+        c = _mm_unpacklo_epi16(c, c); // coverage of every pixel in all of its 4 channels.
+
+        __m128i a_lo = _mm_unpacklo_epi8(c, zero);
+        __m128i a_hi = _mm_unpackhi_epi8(c, zero);
+        if (ca != 255) {
+            a_lo = scale_lanes_sse2(a_lo, scale);
+            a_hi = scale_lanes_sse2(a_hi, scale);
+        }
+
+        __m128i d  = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i lo = blend_lanes_sse2(_mm_unpacklo_epi8(d, zero), s, a_lo);
+        __m128i hi = blend_lanes_sse2(_mm_unpackhi_epi8(d, zero), s, a_hi);
+
+        _mm_storeu_si128((__m128i*) (data + i), _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+
+    blend_span_coverage_scalar(data + i, color, coverage + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_lanes_avx2(__m256i d, __m256i s, __m256i a) {
+    __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    __m256i x  = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(d, ia), _mm256_mullo_epi16(s, a)), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i scale_lanes_avx2(__m256i a, __m256i scale) {
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(a, scale), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static void blend_span_solid_avx2(u32* data, u32 color, u8 alpha, u32 count) {
+    __m256i zero   = _mm256_setzero_si256();
+    __m256i opaque = _mm256_set1_epi32((int) 0xFF000000u);
+    __m256i s      = _mm256_unpacklo_epi8(_mm256_set1_epi32((int) color), zero);
+    __m256i a      = _mm256_set1_epi16(alpha);
+
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i d  = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i lo = blend_lanes_avx2(_mm256_unpacklo_epi8(d, zero), s, a);
+        __m256i hi = blend_lanes_avx2(_mm256_unpackhi_epi8(d, zero), s, a);
+
+        _mm256_storeu_si256((__m256i*) (data + i), _mm256_or_si256(_mm256_packus_epi16(lo, hi), opaque));
+    }
+
+    // @Note: the tail is a sibling call that gcc doesn't put vzeroupper in front of, and legacy sse with dirty upper halves is slower than scalar code.
+    _mm256_zeroupper();
+    blend_span_solid_sse2(data + i, color, alpha, count - i);
+}
+
+__attribute__((target("avx2")))
+static void blend_span_coverage_avx2(u32* data, u32 color, const u8* coverage, u32 count) {
+    u32 ca    = color >> 24;
+    u32 solid = color | 0xFF000000u;
+
+    __m256i zero      = _mm256_setzero_si256();
+    __m256i opaque    = _mm256_set1_epi32((int) 0xFF000000u);
+    __m256i s         = _mm256_unpacklo_epi8(_mm256_set1_epi32((int) color), zero);
+    __m256i scale     = _mm256_set1_epi16((s16) ca);
+    __m256i replicate = _mm256_set1_epi32(0x01010101);
+
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        u64 c8;
+        memcpy(&c8, coverage + i, sizeof(c8));
+
+        if (c8 == 0) {
+            continue;
+        }
+
+        if (c8 == UINT64_MAX && ca == 255) {
+            _mm256_storeu_si256((__m256i*) (data + i), _mm256_set1_epi32((int) solid));
+            continue;
+        }
+
+        // @Note: unpack/pack work inside of 128-bit halves, the same on both coverage and data, so pixel order is preserved.
+        __m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (coverage + i)));
+        c = _mm256_mullo_epi32(c, replicate);
+
+        __m256i a_lo = _mm256_unpacklo_epi8(c, zero);
+        __m256i a_hi = _mm256_unpackhi_epi8(c, zero);
+        if (ca != 255) {
+            a_lo = scale_lanes_avx2(a_lo, scale);
+            a_hi = scale_lanes_avx2(a_hi, scale);
+        }
+
+        __m256i d  = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i lo = blend_lanes_avx2(_mm256_unpacklo_epi8(d, zero), s, a_lo);
+        __m256i hi = blend_lanes_avx2(_mm256_unpackhi_epi8(d, zero), s, a_hi);
+
+        _mm256_storeu_si256((__m256i*) (data + i), _mm256_or_si256(_mm256_packus_epi16(lo, hi), opaque));
+    }
+
+    _mm256_zeroupper();
+    blend_span_coverage_sse2(data + i, color, coverage + i, count - i);
+}
+
+#endif // BLEND_X86
+
+
+static blend_impl_t blend_impl;
+static pthread_once_t blend_once = PTHREAD_ONCE_INIT;
+
+static void select_blend_impl() {
+    blend_impl = (blend_impl_t) {
+        .solid    = blend_span_solid_scalar,
+        .coverage = blend_span_coverage_scalar,
+    };
+
+#ifdef BLEND_X86
+    auto cpu = get_cpu_features();
+
+    if (cpu->avx2) {
+        blend_impl = (blend_impl_t) { .solid = blend_span_solid_avx2, .coverage = blend_span_coverage_avx2 };
+    } else if (cpu->sse2) {
+        blend_impl = (blend_impl_t) { .solid = blend_span_solid_sse2, .coverage = blend_span_coverage_sse2 };
+    }
+#endif
+}
+
+static const blend_impl_t* get_blend_impl() {
+    pthread_once(&blend_once, select_blend_impl);
+    return &blend_impl;
+}
+
+
+void blend_span_solid(u32* data, u32 color, u8 alpha, u32 count) {
+    if (alpha == 0) {
+        return;
+    }
+
+    if (alpha == 255) {
+        fill_span(data, color | 0xFF000000u, count);
+        return;
+    }
+
+    get_blend_impl()->solid(data, color, alpha, count);
+}
+
+void blend_span_coverage(u32* data, u32 color, const u8* coverage, u32 count) {
+    get_blend_impl()->coverage(data, color, coverage, count);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "types.h"
+
+//
+// Source-over blending of a solid color onto an opaque XRGB8888 span in 8-bit fixed point.
+// The color is premultiplied by the alpha (or coverage) and rounded, so the result is within 1 LSB of the float lerp.
+// Results always have an opaque alpha channel, same as the framebuffer.
+//
+
+//
+// @Note: alpha is applied to every pixel of the span, the alpha channel of color is ignored.
+//
+void blend_span_solid(u32* data, u32 color, u8 alpha, u32 count);
+
+//
+// @Note: per-pixel coverage, modulated by the alpha channel of color.
+//
+void blend_span_coverage(u32* data, u32 color, const u8* coverage, u32 count);
+
+u32 blend_pixel(u32 background, u32 color, u8 alpha);
@@ -0,0 +1,25 @@
+#include "cpu.h"
+
+#include <pthread.h>
+
+static cpu_features_t features;
+static pthread_once_t features_once = PTHREAD_ONCE_INIT;
+
+static void query_cpu_features() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    features = (cpu_features_t) {
+        .sse2    = __builtin_cpu_supports("sse2"),
+        .avx2    = __builtin_cpu_supports("avx2"),
+        .avx512f = __builtin_cpu_supports("avx512f"),
+    };
+#else
+    features = (cpu_features_t) {};
+#endif
+}
+
+const cpu_features_t* get_cpu_features() {
+    pthread_once(&features_once, query_cpu_features);
+    return &features;
+}
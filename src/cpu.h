@@ -0,0 +1,14 @@
+#pragma once
+
+#include "types.h"
+
+typedef struct cpu_features_t {
+    bool sse2;
+    bool avx2;
+    bool avx512f;
+} cpu_features_t;
+
+//
+// @Note: queried once, safe to call from any thread.
+//
+const cpu_features_t* get_cpu_features();
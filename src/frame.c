@@ -0,0 +1,346 @@
+#include "frame.h"
+#include "base.h"
+
+#include <string.h>
+
+
+void frame_init(frame_t* frame, u32 arena_size, ui_t* ui) {
+    *frame = (frame_t) { .ui = ui, .occlusion = true };
+    arena_init(&frame->arena, arena_size);
+}
+
+void frame_free(frame_t* frame) {
+    arena_free(&frame->arena);
+}
+
+static bool is_opaque_box(const command_t* command) {
+    return command->type == COMMAND_TYPE_DRAW_BOX && (command->box.color >> 24) == 0xff;
+}
+
+static bool same_box_rect(const command_t* a, const command_t* b) {
+    return a->box.x == b->box.x && a->box.y == b->box.y && a->box.w == b->box.w && a->box.h == b->box.h;
+}
+
+static u32 box_rect_hash(const command_t* command) {
+    u32 bits[4];
+    memcpy(bits, &command->box.x, sizeof(bits));
+
+    u32 h = 0x811c9dc5u;
+    for (s32 i = 0; i < 4; i++) {
+        h = (h ^ bits[i]) * 0x01000193u;
+    }
+    return h ^ (h >> 16);
+}
+
+//
+// Marks pending commands whose pixels all get painted over later in the frame.
+// Returns the index of the first command that survives, the layout of the last DRAW_EVERYTHING covers everything before it.
+//
+static s32 merge_pending(frame_t* frame, const command_buffer_t* pending, bool* merged) {
+    s32 first = 0;
+    for (s32 i = pending->length - 1; i >= 0; i--) {
+        if (pending->commands[i].type == COMMAND_TYPE_DRAW_EVERYTHING) {
+            first = i;
+            break;
+        }
+    }
+
+    // Opaque boxes seen so far walking backwards, open addressing over indices into pending, -1 is empty.
+    u32 capacity = 16;
+    while (capacity < 2 * (u32) (pending->length - first)) {
+        capacity *= 2;
+    }
+
+    s32* seen = arena_push_array_uninitialized(&frame->arena, s32, capacity);
+    memset(seen, 0xff, capacity * sizeof(s32));
+
+    for (s32 i = pending->length - 1; i >= first; i--) {
+        const command_t* command = &pending->commands[i];
+        if (command->type != COMMAND_TYPE_DRAW_BOX) continue;
+
+        u32 slot = box_rect_hash(command) & (capacity - 1);
+        while (seen[slot] != -1 && !same_box_rect(&pending->commands[seen[slot]], command)) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if (seen[slot] != -1) {
+            merged[i] = true;
+        } else if (is_opaque_box(command)) {
+            seen[slot] = i;
+        }
+    }
+
+    return first;
+}
+
+static void swap_commands(frame_t* frame, s32 a, s32 b) {
+    command_t command           = frame->commands.commands[a];
+    frame->commands.commands[a] = frame->commands.commands[b];
+    frame->commands.commands[b] = command;
+
+    rectangle_t bounds = frame->bounds[a];
+    frame->bounds[a]   = frame->bounds[b];
+    frame->bounds[b]   = bounds;
+}
+
+//
+// Insertion sort by type, where a command only moves past commands that it doesn't overlap,
+// so that the pixels come out the same as in submission order.
+//
+static void sort_into_batches(frame_t* frame) {
+    command_t* commands = frame->commands.commands;
+
+    for (s32 i = 1; i < frame->commands.length; i++) {
+        for (s32 j = i; j > 0 && i - j < FRAME_SORT_WINDOW; j--) {
+            if (commands[j - 1].type <= commands[j].type) break;
+            if (!rectangle_is_empty(intersect_rectangles(frame->bounds[j - 1], frame->bounds[j]))) break;
+
+            swap_commands(frame, j - 1, j);
+        }
+    }
+}
+
+// rect minus hole, up to 4 pieces: the rows above and below the hole, and the parts left and right of it.
+static s32 subtract_rectangle(rectangle_t rect, rectangle_t hole, rectangle_t* pieces) {
+    rectangle_t inside = intersect_rectangles(rect, hole);
+    if (rectangle_is_empty(inside)) {
+        pieces[0] = rect;
+        return 1;
+    }
+
+    s32 count = 0;
+    s32 rect_bottom   = rect.y + rect.h;
+    s32 inside_bottom = inside.y + inside.h;
+
+    if (inside.y > rect.y) {
+        pieces[count++] = (rectangle_t) { .x = rect.x, .y = rect.y, .w = rect.w, .h = inside.y - rect.y };
+    }
+    if (inside_bottom < rect_bottom) {
+        pieces[count++] = (rectangle_t) { .x = rect.x, .y = inside_bottom, .w = rect.w, .h = rect_bottom - inside_bottom };
+    }
+    if (inside.x > rect.x) {
+        pieces[count++] = (rectangle_t) { .x = rect.x, .y = inside.y, .w = inside.x - rect.x, .h = inside.h };
+    }
+    if (inside.x + inside.w < rect.x + rect.w) {
+        pieces[count++] = (rectangle_t) { .x = inside.x + inside.w, .y = inside.y, .w = rect.x + rect.w - (inside.x + inside.w), .h = inside.h };
+    }
+
+    return count;
+}
+
+//
+// Parts of the bounds of command i that no opaque box drawn after it paints over.
+// @Note: when a subtraction would split into more than FRAME_MAX_VISIBLE_PIECES pieces the piece is kept whole, which only means some overdraw.
+//
+static s32 visible_pieces(const frame_t* frame, const s32* occluders, s32 occluder_count, s32 i, rectangle_t* pieces) {
+    s32 count = 1;
+    pieces[0] = frame->bounds[i];
+
+    for (s32 o = occluder_count - 1; o >= 0 && occluders[o] > i && count > 0; o--) {
+        rectangle_t hole = frame->bounds[occluders[o]];
+
+        rectangle_t next[FRAME_MAX_VISIBLE_PIECES];
+        s32 next_count = 0;
+
+        for (s32 p = 0; p < count; p++) {
+            rectangle_t split[4];
+            s32 split_count = subtract_rectangle(pieces[p], hole, split);
+
+            if (next_count + split_count > FRAME_MAX_VISIBLE_PIECES - (count - p - 1)) {
+                next[next_count++] = pieces[p];
+                continue;
+            }
+
+            for (s32 k = 0; k < split_count; k++) {
+                next[next_count++] = split[k];
+            }
+        }
+
+        memcpy(pieces, next, (size_t) next_count * sizeof(rectangle_t));
+        count = next_count;
+    }
+
+    return count;
+}
+
+//
+// Replaces every command by the pieces of it that end up visible, each piece is drawn as the command clipped to it.
+// Only opaque boxes hide what's under them: they write every pixel of their bounds, everything else blends or has antialiased edges.
+//
+static void cull_occluded(frame_t* frame) {
+    s32 count = frame->commands.length;
+
+    // Topmost opaque boxes, in drawing order.
+    s32* occluders     = arena_push_array_uninitialized(&frame->arena, s32, FRAME_MAX_OCCLUDERS);
+    s32 occluder_count = 0;
+
+    for (s32 i = count - 1; i >= 0 && occluder_count < FRAME_MAX_OCCLUDERS; i--) {
+        if (is_opaque_box(&frame->commands.commands[i])) {
+            occluders[occluder_count++] = i;
+        }
+    }
+    for (s32 a = 0, b = occluder_count - 1; a < b; a++, b--) {
+        s32 t = occluders[a]; occluders[a] = occluders[b]; occluders[b] = t;
+    }
+
+    // @Note: pieces are computed twice, once to size the output and once to fill it in.
+    rectangle_t pieces[FRAME_MAX_VISIBLE_PIECES];
+
+    s32 total = 0;
+    for (s32 i = 0; i < count; i++) {
+        total += visible_pieces(frame, occluders, occluder_count, i, pieces);
+    }
+
+    command_t*   commands = arena_push_array_uninitialized(&frame->arena, command_t,   max(total, 1));
+    rectangle_t* bounds   = arena_push_array_uninitialized(&frame->arena, rectangle_t, max(total, 1));
+
+    s32 written = 0;
+    for (s32 i = 0; i < count; i++) {
+        s32 piece_count = visible_pieces(frame, occluders, occluder_count, i, pieces);
+
+        u64 visible = 0;
+        for (s32 p = 0; p < piece_count; p++) {
+            commands[written] = frame->commands.commands[i];
+            bounds[written]   = pieces[p];
+            written += 1;
+
+            visible += (u64) pieces[p].w * pieces[p].h;
+        }
+
+        frame->stats.occluded_pixels += (u64) frame->bounds[i].w * frame->bounds[i].h - visible;
+    }
+
+    frame->commands.commands = commands;
+    frame->commands.length   = total;
+    frame->commands.capacity = total;
+    frame->bounds            = bounds;
+}
+
+typedef struct {
+    s32 first, end;   // expanded commands.
+    rectangle_t clip;
+} expansion_t;
+
+// Nodes of the ui are redrawn inside of clip only.
+static void expand_ui(frame_t* frame, expansion_t* expansion, rectangle_t clip) {
+    expansion->first = frame->commands.length;
+    ui_add_commands(frame->ui, &frame->commands, clip);
+    expansion->end   = frame->commands.length;
+    expansion->clip  = clip;
+
+    region_add(&frame->damage, clip);
+}
+
+void build_frame(frame_t* frame, buffer_t* buffer, const command_buffer_t* pending, s32 damage_rect_budget) {
+    rectangle_t whole = buffer_rectangle(buffer);
+
+    arena_reset(&frame->arena);
+    region_init(&frame->damage, damage_rect_budget, whole);
+    frame->stats = (frame_stats_t) { .pending = pending->length };
+
+    // @Note: only set by an expanded DRAW_EVERYTHING, the coalesced damage can span the buffer with parts nothing draws.
+    frame->everything = false;
+
+    render_begin_frame();
+    ui_update_rects(frame->ui, buffer);
+
+    bool* merged = arena_push_array(&frame->arena, bool, pending->length + 1);
+    s32 first    = merge_pending(frame, pending, merged);
+
+    // Dirty nodes are redrawn first, pending commands go on top of the ui.
+    region_t dirty;
+    region_init(&dirty, damage_rect_budget, whole);
+
+    if (first < pending->length && pending->commands[first].type == COMMAND_TYPE_DRAW_EVERYTHING) {
+        ui_clear_dirty(frame->ui);
+        frame->everything = true;
+    } else {
+        ui_collect_damage(frame->ui, &dirty);
+    }
+
+    s32 expansion_count = dirty.count;
+    for (s32 i = first; i < pending->length; i++) {
+        command_type_t type = pending->commands[i].type;
+        expansion_count += !merged[i] && (type == COMMAND_TYPE_DRAW_EVERYTHING || type == COMMAND_TYPE_DRAW_REGION);
+    }
+
+    // @Note: allocated before the commands, so that the command buffer is the last thing in the arena and grows in place.
+    expansion_t* expansions = arena_push_array_uninitialized(&frame->arena, expansion_t, expansion_count + 1);
+
+    command_buffer_init(&frame->commands, &frame->arena);
+
+    expansion_count = 0;
+    for (s32 i = 0; i < dirty.count; i++) {
+        expand_ui(frame, &expansions[expansion_count++], dirty.rects[i]);
+    }
+
+    for (s32 i = first; i < pending->length; i++) {
+        command_t command = pending->commands[i];
+
+        if (merged[i]) {
+            frame->stats.merged += 1;
+
+        } else if (command.type == COMMAND_TYPE_DRAW_EVERYTHING) {
+            expand_ui(frame, &expansions[expansion_count++], whole);
+            frame->everything = true;
+
+        } else if (command.type == COMMAND_TYPE_DRAW_REGION) {
+            command_t box = {
+                .type = COMMAND_TYPE_DRAW_BOX,
+                .box  = { .x = command.region.x, .y = command.region.y, .w = command.region.w, .h = command.region.h },
+            };
+            expand_ui(frame, &expansions[expansion_count++], command_bounds(buffer, &box));
+
+        } else {
+            add_command(&frame->commands, command);
+        }
+    }
+    frame->stats.merged += first;
+
+    frame->bounds = arena_push_array_uninitialized(&frame->arena, rectangle_t, max(frame->commands.length, 1));
+
+    s32 count     = 0;
+    s32 expansion = 0;
+    for (s32 i = 0; i < frame->commands.length; i++) {
+        while (expansion < expansion_count && expansions[expansion].end <= i) {
+            expansion += 1;
+        }
+
+        // Commands of their own are not clipped, they damage whatever they touch.
+        bool expanded    = expansion < expansion_count && expansions[expansion].first <= i;
+        rectangle_t clip = expanded ? expansions[expansion].clip : whole;
+
+        rectangle_t bounds = intersect_rectangles(command_bounds(buffer, &frame->commands.commands[i]), clip);
+
+        if (rectangle_is_empty(bounds)) {
+            frame->stats.culled += 1;
+            continue;
+        }
+
+        // @Note: layout commands are inside of a rect that's already in the damage, they merge away.
+        region_add(&frame->damage, bounds);
+
+        frame->commands.commands[count] = frame->commands.commands[i];
+        frame->bounds[count]            = bounds;
+        count += 1;
+    }
+    frame->commands.length = count;
+
+    if (frame->occlusion) {
+        cull_occluded(frame);
+    }
+
+    sort_into_batches(frame);
+
+    frame->stats.drawn = frame->commands.length;
+    for (s32 i = 0; i < frame->commands.length; i++) {
+        if (i == 0 || frame->commands.commands[i].type != frame->commands.commands[i - 1].type) {
+            frame->stats.batches += 1;
+        }
+        frame->stats.pixels += (u64) frame->bounds[i].w * frame->bounds[i].h;
+    }
+}
+
+void execute_frame(tile_renderer_t* renderer, buffer_t* buffer, frame_t* frame) {
+    tile_renderer_execute(renderer, buffer, frame->commands.commands, frame->bounds, frame->commands.length);
+}
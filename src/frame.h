@@ -0,0 +1,63 @@
+#pragma once
+
+#include "render.h"
+#include "region.h"
+#include "ui.h"
+#include "memory_arena.h"
+#include "tile_renderer.h"
+
+enum {
+    PENDING_COMMANDS_ARENA_SIZE = 1024 * 1024,
+    FRAME_ARENA_SIZE            = 4 * PENDING_COMMANDS_ARENA_SIZE, // @Note: a frame needs bounds and bookkeeping on top of the pending commands.
+
+    FRAME_SORT_WINDOW = 64, // @Note: how far back a command can move to join a batch, keeps sorting linear under bursts of input.
+
+    FRAME_MAX_OCCLUDERS      = 64, // topmost opaque boxes that hide what's under them.
+    FRAME_MAX_VISIBLE_PIECES = 16, // rects a command can be split into by the occluders.
+};
+
+typedef struct {
+    s32 pending; // commands submitted since the last frame.
+    s32 merged;  // pending commands dropped because a later one paints over all of their pixels.
+    s32 culled;  // commands that don't touch any pixels.
+    s32 drawn;   // after occlusion a command is drawn once for every visible piece of it.
+    s32 batches; // runs of commands of the same type after sorting.
+
+    u64 pixels;          // pixels inside of the drawn bounds, which is what the rasterizers write (or blend into).
+    u64 occluded_pixels; // pixels not drawn because an opaque box on top of them paints over them anyway.
+} frame_stats_t;
+
+//
+// Pending commands expanded into primitives, with the pixels each of them is allowed to touch.
+// Used by both the wayland client and the headless replay, so that both draw exactly the same thing.
+//
+typedef struct {
+    memory_arena_t arena; // commands and bounds, reset by every build_frame.
+    ui_t* ui;
+
+    command_buffer_t commands;
+    rectangle_t* bounds; // command_bounds clipped to the rect the command was redrawn for, drawing is clipped to these.
+
+    region_t damage;  // everything drawn this frame, coalesced. This is what gets sent to the compositor.
+    bool everything;  // a DRAW_EVERYTHING redrew the whole buffer, nothing needs to be copied forward.
+
+    bool occlusion;   // skip what opaque boxes paint over, on by default.
+
+    frame_stats_t stats;
+} frame_t;
+
+void frame_init(frame_t* frame, u32 arena_size, ui_t* ui);
+void frame_free(frame_t* frame);
+
+//
+// Dirty nodes of the ui are redrawn first, then the pending commands on top of them.
+// DRAW_EVERYTHING and DRAW_REGION expand into the nodes of the ui that intersect the buffer or the rect of the region, clipped to it.
+//
+// Pending commands that get painted over by the frame are merged away: everything before the last DRAW_EVERYTHING,
+// and opaque boxes repainted by a later opaque box with the same rect. Commands are then split into the pieces that no later
+// opaque box covers, and sorted by type where that doesn't change the result, commands only move past commands they don't overlap.
+//
+// @Note: damage_rect_budget is how many rects the damage is coalesced into, 1 .. MAX_REGION_RECTS.
+//
+void build_frame(frame_t* frame, buffer_t* buffer, const command_buffer_t* pending, s32 damage_rect_budget);
+void execute_frame(tile_renderer_t* renderer, buffer_t* buffer, frame_t* frame);
@@ -0,0 +1,83 @@
+#include "frame_scheduler.h"
+
+#include <assert.h>
+
+
+static void frame_done(void* data, struct wl_callback* callback, uint32_t time);
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+static void frame_done(void* data, struct wl_callback* callback, uint32_t time) {
+    frame_scheduler_t* scheduler = data;
+    assert(scheduler->callback == callback);
+
+    // @Note: a frame was waiting for the previous callback, so it should have been on screen one refresh after it.
+    // Every refresh past that is a missed deadline.
+    if (scheduler->has_last_done && scheduler->continuous) {
+        u64 elapsed = (u32) (time - scheduler->last_done);
+        u64 cycles  = (elapsed * scheduler->refresh + 500000) / 1000000;
+        if (cycles > 1) {
+            scheduler->stats.missed += cycles - 1;
+        }
+    }
+
+    scheduler->last_done     = time;
+    scheduler->has_last_done = true;
+    scheduler->continuous    = scheduler->queued;
+
+    wl_callback_destroy(callback);
+    scheduler->callback = NULL;
+}
+
+void frame_scheduler_init(frame_scheduler_t* scheduler) {
+    *scheduler = (frame_scheduler_t) {
+        .refresh = FRAME_SCHEDULER_DEFAULT_REFRESH,
+    };
+}
+
+void frame_scheduler_destroy(frame_scheduler_t* scheduler) {
+    if (scheduler->callback) {
+        wl_callback_destroy(scheduler->callback);
+    }
+    *scheduler = (frame_scheduler_t) {};
+}
+
+void frame_scheduler_set_refresh(frame_scheduler_t* scheduler, s32 refresh) {
+    if (refresh > 0) {
+        scheduler->refresh = (u32) refresh;
+    }
+}
+
+void frame_scheduler_request(frame_scheduler_t* scheduler) {
+    scheduler->stats.requests += 1;
+
+    if (scheduler->queued) {
+        scheduler->stats.coalesced += 1;
+    }
+    scheduler->queued = true;
+}
+
+bool frame_scheduler_ready(frame_scheduler_t* scheduler) {
+    return scheduler->queued && scheduler->callback == NULL;
+}
+
+void frame_scheduler_cancel(frame_scheduler_t* scheduler) {
+    scheduler->queued     = false;
+    scheduler->continuous = false;
+}
+
+void frame_scheduler_begin(frame_scheduler_t* scheduler) {
+    scheduler->queued = false;
+}
+
+void frame_scheduler_commit(frame_scheduler_t* scheduler, struct wl_surface* surface) {
+    assert(scheduler->callback == NULL);
+
+    scheduler->callback = wl_surface_frame(surface);
+    wl_callback_add_listener(scheduler->callback, &frame_listener, scheduler);
+
+    // @Note: queued isn't touched, it was cleared when the frame was handed off and is set again by what came in since.
+    scheduler->stats.frames += 1;
+}
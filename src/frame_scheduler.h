@@ -0,0 +1,69 @@
+#pragma once
+
+#include "types.h"
+
+#include <wayland-client.h>
+
+//
+// Paces rendering to the compositor with wl_surface_frame callbacks.
+//
+// Input handlers only update state and call frame_scheduler_request, the main loop draws once all of the pending
+// events are dispatched and the compositor is ready for a new frame. So however many events arrive between two
+// frames, there is at most one frame per compositor frame and it always shows the latest state.
+//
+// @Note: the compositor stops sending frame callbacks for hidden surfaces, we don't draw those at all.
+//
+
+enum {
+    FRAME_SCHEDULER_DEFAULT_REFRESH = 60000, // mHz, until the output tells us its mode.
+};
+
+typedef struct {
+    u64 frames;    // frames committed.
+    u64 requests;  // frame_scheduler_request calls.
+    u64 coalesced; // requests folded into a frame that was already queued.
+    u64 missed;    // refresh cycles a queued frame waited past, because drawing took too long or no buffer was free.
+} frame_scheduler_stats_t;
+
+typedef struct {
+    struct wl_callback* callback; // frame callback of the last commit, NULL once the compositor is ready for the next frame.
+
+    bool queued;     // something changed since the last frame was handed off to be drawn.
+    bool continuous; // the last frame was queued before the previous callback came, it should have been drawn right after it.
+
+    u32 refresh;         // mHz.
+    u32 last_done;       // ms, timestamp of the last frame callback.
+    bool has_last_done;
+
+    frame_scheduler_stats_t stats;
+} frame_scheduler_t;
+
+void frame_scheduler_init(frame_scheduler_t* scheduler);
+void frame_scheduler_destroy(frame_scheduler_t* scheduler);
+
+void frame_scheduler_set_refresh(frame_scheduler_t* scheduler, s32 refresh);
+
+//
+// State changed, a frame should be drawn when the compositor is ready for it.
+//
+void frame_scheduler_request(frame_scheduler_t* scheduler);
+
+//
+// A frame is queued and the compositor is done with the last one.
+//
+bool frame_scheduler_ready(frame_scheduler_t* scheduler);
+
+//
+// The queued frame turned out to have nothing to draw.
+//
+void frame_scheduler_cancel(frame_scheduler_t* scheduler);
+
+//
+// The queued frame was built and is being drawn, whatever is requested from now on queues the next one.
+//
+void frame_scheduler_begin(frame_scheduler_t* scheduler);
+
+//
+// Call right before wl_surface_commit of a new frame, asks for the callback that paces the next one.
+//
+void frame_scheduler_commit(frame_scheduler_t* scheduler, struct wl_surface* surface);
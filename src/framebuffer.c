@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include "framebuffer.h"
+#include "base.h"
+#include "log.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+static void buffer_release(void* data, struct wl_buffer* wl_buffer);
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static void mark_stale(framebuffer_slot_t* slot, rectangle_t rect) {
+    region_add(&slot->stale, rect);
+}
+
+static bool truncate_shared_file(int fd, u32 size) {
+    int ret;
+    do {
+        ret = ftruncate(fd, size);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret == 0;
+}
+
+// Makes room for count slots of size bytes, grows the memfd, the mapping and the pool when they are too small.
+static bool reserve_slots(framebuffer_manager_t* manager, u32 size) {
+    if (size <= manager->slot_size) {
+        manager->stats.resizes_in_place += 1;
+        return true;
+    }
+
+    // @Note: growth is geometric while resizing, so dragging a window edge outwards takes a logarithmic number of pool grows.
+    if (manager->interactive && size < manager->slot_size + manager->slot_size / 2) {
+        size = manager->slot_size + manager->slot_size / 2;
+    }
+    size = (size + FRAMEBUFFER_PAGE_SIZE - 1) & ~(u32) (FRAMEBUFFER_PAGE_SIZE - 1);
+
+    u32 pool_size = size * (u32) manager->count;
+
+    if (pool_size > manager->pool_size) {
+        if (!truncate_shared_file(manager->fd, pool_size)) {
+            log_error(LOG_WAYLAND, "Couldn't grow the framebuffer pool to %u bytes: %s", pool_size, strerror(errno));
+            return false;
+        }
+
+        void* data = manager->data
+            ? mremap(manager->data, manager->pool_size, pool_size, MREMAP_MAYMOVE)
+            : mmap(NULL, pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, manager->fd, 0);
+
+        if (data == MAP_FAILED) {
+            log_error(LOG_WAYLAND, "Couldn't map %u bytes of the framebuffer pool: %s", pool_size, strerror(errno));
+            return false;
+        }
+        manager->data = data;
+
+        if (manager->pool) {
+            wl_shm_pool_resize(manager->pool, (int32_t) pool_size);
+        } else {
+            manager->pool = wl_shm_create_pool(manager->shm, manager->fd, (int32_t) pool_size);
+        }
+
+        manager->pool_size = pool_size;
+        manager->stats.pool_grows += 1;
+    }
+
+    manager->slot_size = size;
+    for (s32 i = 0; i < manager->count; i++) {
+        manager->slots[i].offset = (u32) i * size;
+    }
+
+    return true;
+}
+
+bool framebuffer_init(framebuffer_manager_t* manager, struct wl_shm* shm, s32 count, s32 width, s32 height) {
+    assert(count >= 1 && count <= FRAMEBUFFER_MAX_BUFFERS);
+
+    *manager = (framebuffer_manager_t) {
+        .shm            = shm,
+        .fd             = memfd_create("my-shell-shared", MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_NOEXEC_SEAL),
+        .count          = count,
+        .last_presented = -1,
+    };
+
+    if (manager->fd < 0) {
+        log_error(LOG_WAYLAND, "Couldn't create the framebuffer memfd: %s", strerror(errno));
+        return false;
+    }
+
+    if (!framebuffer_resize(manager, width, height)) {
+        framebuffer_destroy(manager);
+        return false;
+    }
+    return true;
+}
+
+void framebuffer_destroy(framebuffer_manager_t* manager) {
+    for (s32 i = 0; i < manager->count; i++) {
+        if (manager->slots[i].buffer.buffer) {
+            wl_buffer_destroy(manager->slots[i].buffer.buffer);
+        }
+    }
+
+    for (s32 i = 0; i < manager->retired_count; i++) {
+        wl_buffer_destroy(manager->retired[i].buffer);
+    }
+
+    if (manager->pool) wl_shm_pool_destroy(manager->pool);
+    if (manager->data) munmap(manager->data, manager->pool_size);
+    if (manager->fd >= 0) close(manager->fd);
+    free(manager->retired);
+
+    *manager = (framebuffer_manager_t) { .fd = -1, .last_presented = -1 };
+}
+
+// Makes room for count more retired buffers.
+static bool reserve_retired(framebuffer_manager_t* manager, s32 count) {
+    if (manager->retired_count + count <= manager->retired_capacity) {
+        return true;
+    }
+
+    s32 capacity = max(manager->retired_capacity * 2, (s32) FRAMEBUFFER_MIN_RETIRED);
+    capacity     = max(capacity, manager->retired_count + count);
+
+    framebuffer_retired_t* retired = realloc(manager->retired, (size_t) capacity * sizeof(framebuffer_retired_t));
+    if (retired == NULL) {
+        log_error(LOG_WAYLAND, "Couldn't grow the list of retired framebuffers to %d.", capacity);
+        return false;
+    }
+
+    manager->retired          = retired;
+    manager->retired_capacity = capacity;
+    return true;
+}
+
+bool framebuffer_resize(framebuffer_manager_t* manager, s32 width, s32 height) {
+    if (manager->data && width == manager->width && height == manager->height) {
+        return true;
+    }
+
+    s32 busy = 0;
+    u32 offsets[FRAMEBUFFER_MAX_BUFFERS];
+    for (s32 i = 0; i < manager->count; i++) {
+        busy      += manager->slots[i].buffer.buffer && manager->slots[i].busy;
+        offsets[i] = manager->slots[i].offset;
+    }
+
+    // @Note: everything that can fail goes first, on failure the slots, their buffers and the size are left as they were.
+    if (!reserve_retired(manager, busy) || !reserve_slots(manager, (u32) (width * height) * sizeof(u32))) {
+        return false;
+    }
+
+    for (s32 i = 0; i < manager->count; i++) {
+        framebuffer_slot_t* slot = &manager->slots[i];
+
+        if (slot->buffer.buffer) {
+            if (slot->busy) {
+                // @Note: where the buffer was before reserve_slots moved the slots.
+                manager->retired[manager->retired_count++] = (framebuffer_retired_t) {
+                    .buffer = slot->buffer.buffer,
+                    .offset = offsets[i],
+                    .size   = (u32) (slot->buffer.width * slot->buffer.height) * sizeof(u32),
+                };
+            } else {
+                wl_buffer_destroy(slot->buffer.buffer);
+            }
+        }
+
+        *slot = (framebuffer_slot_t) { .offset = slot->offset };
+
+        rectangle_t whole = { .x = 0, .y = 0, .w = width, .h = height };
+        region_init(&slot->stale, REGION_DEFAULT_RECT_BUDGET, whole);
+        mark_stale(slot, whole);
+    }
+
+    manager->width          = width;
+    manager->height         = height;
+    manager->last_presented = -1;
+    manager->stats.resizes += 1;
+
+    return true;
+}
+
+void framebuffer_set_interactive(framebuffer_manager_t* manager, bool interactive) {
+    manager->interactive = interactive;
+}
+
+static void buffer_release(void* data, struct wl_buffer* wl_buffer) {
+    framebuffer_manager_t* manager = data;
+
+    for (s32 i = 0; i < manager->count; i++) {
+        if (manager->slots[i].buffer.buffer == wl_buffer) {
+            manager->slots[i].busy = false;
+        }
+    }
+
+    for (s32 i = 0; i < manager->retired_count; i++) {
+        if (manager->retired[i].buffer == wl_buffer) {
+            wl_buffer_destroy(wl_buffer);
+            manager->retired[i] = manager->retired[--manager->retired_count];
+            break;
+        }
+    }
+}
+
+// Free, and none of its memory is still read by the compositor through a buffer of an old size.
+static bool slot_is_available(framebuffer_manager_t* manager, s32 index) {
+    framebuffer_slot_t* slot = &manager->slots[index];
+    if (slot->busy) {
+        return false;
+    }
+
+    u32 begin = slot->offset;
+    u32 end   = slot->offset + (u32) (manager->width * manager->height) * sizeof(u32);
+
+    for (s32 i = 0; i < manager->retired_count; i++) {
+        framebuffer_retired_t* retired = &manager->retired[i];
+        if (begin < retired->offset + retired->size && retired->offset < end) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool framebuffer_available(framebuffer_manager_t* manager) {
+    for (s32 i = 0; i < manager->count; i++) {
+        if (slot_is_available(manager, i)) return true;
+    }
+    return false;
+}
+
+buffer_t* framebuffer_acquire(framebuffer_manager_t* manager) {
+    if (manager->data == NULL) {
+        return NULL;
+    }
+
+    // @Note: the most recently presented free buffer is the one closest to what's on screen.
+    s32 best = -1;
+    for (s32 i = 0; i < manager->count; i++) {
+        if (!slot_is_available(manager, i)) continue;
+
+        if (best == -1 || manager->slots[i].presented_frame > manager->slots[best].presented_frame) {
+            best = i;
+        }
+    }
+
+    if (best == -1) {
+        manager->stats.stalls += 1;
+        return NULL;
+    }
+
+    framebuffer_slot_t* slot = &manager->slots[best];
+
+    if (slot->buffer.buffer == NULL) {
+        s32 stride = manager->width * (s32) sizeof(u32);
+
+        slot->buffer = (buffer_t) {
+            .buffer = wl_shm_pool_create_buffer(manager->pool, (int32_t) slot->offset, manager->width, manager->height, stride, WL_SHM_FORMAT_XRGB8888),
+            .width  = manager->width,
+            .height = manager->height,
+        };
+        wl_buffer_add_listener(slot->buffer.buffer, &buffer_listener, manager);
+
+        manager->stats.buffers_created += 1;
+    }
+
+    // @Note: the pool may have moved since the buffer was created.
+    slot->buffer.data = (u32*) (manager->data + slot->offset);
+    return &slot->buffer;
+}
+
+static s32 slot_index(framebuffer_manager_t* manager, buffer_t* buffer) {
+    s32 index = (s32) ((framebuffer_slot_t*) buffer - manager->slots);
+    assert(index >= 0 && index < manager->count && &manager->slots[index].buffer == buffer);
+    return index;
+}
+
+bool framebuffer_has_previous(framebuffer_manager_t* manager, buffer_t* buffer) {
+    slot_index(manager, buffer);
+    return manager->last_presented != -1;
+}
+
+void framebuffer_copy_forward(framebuffer_manager_t* manager, buffer_t* buffer) {
+    s32 index = slot_index(manager, buffer);
+    if (manager->last_presented == -1 || manager->last_presented == index) {
+        return;
+    }
+
+    region_t* stale = &manager->slots[index].stale;
+    if (region_is_empty(stale)) {
+        return;
+    }
+
+    const u32* source = (const u32*) (manager->data + manager->slots[manager->last_presented].offset);
+    s32 stride = buffer->width;
+
+    for (s32 i = 0; i < stale->count; i++) {
+        rectangle_t rect = stale->rects[i];
+
+        if (rect.x == 0 && rect.w == stride) {
+            // @Note: full rows are contiguous, one memcpy for all of them.
+            size_t offset = (size_t) rect.y * stride;
+            memcpy(buffer->data + offset, source + offset, (size_t) rect.w * rect.h * sizeof(u32));
+        } else {
+            for (s32 y = rect.y; y < rect.y + rect.h; y++) {
+                size_t offset = (size_t) y * stride + rect.x;
+                memcpy(buffer->data + offset, source + offset, (size_t) rect.w * sizeof(u32));
+            }
+        }
+    }
+
+    manager->stats.copies        += 1;
+    manager->stats.copied_pixels += region_area(stale);
+    region_clear(stale);
+}
+
+void framebuffer_present(framebuffer_manager_t* manager, buffer_t* buffer, const region_t* damage) {
+    s32 index = slot_index(manager, buffer);
+
+    for (s32 i = 0; i < manager->count; i++) {
+        framebuffer_slot_t* slot = &manager->slots[i];
+        if (i == index) {
+            region_clear(&slot->stale);
+            continue;
+        }
+
+        for (s32 j = 0; j < damage->count; j++) {
+            mark_stale(slot, damage->rects[j]);
+        }
+    }
+
+    manager->frame += 1;
+    manager->slots[index].busy            = true;
+    manager->slots[index].presented_frame = manager->frame;
+    manager->last_presented               = index;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+#include "region.h"
+
+#include <wayland-client.h>
+
+//
+// Ring of framebuffers sub-allocated from one memfd backed wl_shm_pool.
+//
+// Every buffer has a fixed slot of slot_size bytes in the pool. The pool only grows: when a bigger size doesn't fit into the
+// slots anymore the memfd is truncated to the new size, remapped and the pool is resized with wl_shm_pool_resize.
+// Same size frames reuse the same wl_buffers, so steady state rendering doesn't make any syscalls here.
+//
+// During an interactive resize the slots grow geometrically, so shrinking and small growth only create wl_buffers
+// with the new size and stride in the slots we already have, instead of touching the memfd and the mapping.
+//
+// Drawing never waits for the compositor: framebuffer_acquire hands out a buffer the compositor doesn't hold,
+// and when all of them are held the frame is simply drawn after the next release.
+//
+// Every slot tracks the damage of the frames presented since it was last presented itself, which is where it is stale.
+// Before a partial redraw only those rects are copied forward from the last presented buffer, so the cost of a small
+// change doesn't depend on how many buffers are in flight.
+//
+// @Note: wl_buffers that were attached when the size changed are destroyed when the compositor releases them,
+// and slots whose memory such a buffer still covers are not handed out until then.
+//
+
+enum {
+    FRAMEBUFFER_MAX_BUFFERS     = 3,
+    FRAMEBUFFER_DEFAULT_BUFFERS = 3, // @Note: with two, the compositor holding one and us having just committed the other means waiting.
+    FRAMEBUFFER_MIN_RETIRED     = 8, // @Note: the list grows past that, memory the compositor may still read is never reused.
+
+    FRAMEBUFFER_PAGE_SIZE = 4096, // slots are rounded up to it.
+};
+
+typedef struct {
+    buffer_t buffer;      // .buffer is NULL until the slot is used at the current size.
+    u32  offset;          // in the pool.
+    bool busy;            // attached, waiting for the release.
+    u64  presented_frame; // 0 when the contents are garbage.
+    region_t stale;       // where the contents differ from the last presented frame, the whole buffer when they are garbage.
+} framebuffer_slot_t;
+
+typedef struct {
+    struct wl_buffer* buffer;
+    u32 offset;
+    u32 size;
+} framebuffer_retired_t;
+
+typedef struct {
+    u64 pool_grows;     // each one is ftruncate + mremap + wl_shm_pool_resize.
+    u64 resizes;
+    u64 resizes_in_place; // resizes that fit into the slots we already had.
+    u64 buffers_created;
+    u64 stalls;         // frames that had to wait because every buffer was held by the compositor.
+    u64 copies;         // frames that copied the previous frame forward.
+    u64 copied_pixels;
+} framebuffer_stats_t;
+
+typedef struct framebuffer_manager_t {
+    struct wl_shm*      shm;
+    struct wl_shm_pool* pool;
+    int   fd;
+    u8*   data;
+    u32   pool_size;
+    u32   slot_size;
+
+    bool interactive; // the user is dragging the window edge, over-allocate the slots for the sizes to come.
+
+    s32 width;
+    s32 height;
+
+    framebuffer_slot_t slots[FRAMEBUFFER_MAX_BUFFERS];
+    s32 count;
+
+    framebuffer_retired_t* retired; // malloc.
+    s32 retired_count;
+    s32 retired_capacity;
+
+    u64 frame;
+    s32 last_presented; // slot, -1 when nothing was presented at the current size.
+
+    framebuffer_stats_t stats;
+} framebuffer_manager_t;
+
+bool framebuffer_init(framebuffer_manager_t* manager, struct wl_shm* shm, s32 count, s32 width, s32 height);
+void framebuffer_destroy(framebuffer_manager_t* manager);
+
+//
+// Contents of every buffer are lost, the next frame has to redraw everything. Does nothing when the size is the same.
+// false when the pool couldn't grow, the buffers keep the old size then and stay usable.
+//
+bool framebuffer_resize(framebuffer_manager_t* manager, s32 width, s32 height);
+
+//
+// While set, slots that are too small grow by half of their size on top of what's needed.
+//
+void framebuffer_set_interactive(framebuffer_manager_t* manager, bool interactive);
+
+bool framebuffer_available(framebuffer_manager_t* manager);
+
+//
+// A buffer the compositor doesn't hold, NULL when there is none. Counts a stall then.
+//
+buffer_t* framebuffer_acquire(framebuffer_manager_t* manager);
+
+//
+// Whether the acquired buffer can be brought up to date with framebuffer_copy_forward,
+// otherwise the frame drawn into it has to redraw everything.
+//
+bool framebuffer_has_previous(framebuffer_manager_t* manager, buffer_t* buffer);
+
+//
+// Copies the parts of the last presented frame that buffer missed into it, if that's a different buffer.
+//
+void framebuffer_copy_forward(framebuffer_manager_t* manager, buffer_t* buffer);
+
+//
+// Call after the buffer was attached and committed, damage is what the frame drawn into it changed.
+//
+void framebuffer_present(framebuffer_manager_t* manager, buffer_t* buffer, const region_t* damage);
@@ -0,0 +1,318 @@
+#include "glyph_atlas.h"
+#include "base.h"
+#include "log.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void glyph_atlas_init(glyph_atlas_t* atlas) {
+    *atlas = (glyph_atlas_t) {
+        .table = calloc(GLYPH_TABLE_CAPACITY, sizeof(glyph_entry_t)),
+        .frame = 1,
+    };
+}
+
+void glyph_atlas_free(glyph_atlas_t* atlas) {
+    for (s32 i = 0; i < atlas->page_count; i++) {
+        stbtt_PackEnd(&atlas->pages[i].pack);
+        free(atlas->pages[i].pixels);
+    }
+
+    for (s32 i = 0; i < atlas->font_count; i++) {
+        free(atlas->fonts[i]);
+    }
+
+    free(atlas->table);
+    *atlas = (glyph_atlas_t) {};
+}
+
+s32 glyph_atlas_add_font(glyph_atlas_t* atlas, const char* path) {
+    if (atlas->font_count == GLYPH_ATLAS_MAX_FONTS) {
+        return -1;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    u8* data = malloc(size);
+    size_t read = fread(data, 1, size, file);
+    fclose(file);
+
+    stbtt_fontinfo info;
+    if (read != (size_t) size || !stbtt_InitFont(&info, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+        free(data);
+        return -1;
+    }
+
+    atlas->fonts[atlas->font_count] = data;
+    return atlas->font_count++;
+}
+
+void glyph_atlas_begin_frame(glyph_atlas_t* atlas) {
+    atlas->frame += 1;
+}
+
+
+static u32 glyph_hash(s32 font, f32 size, u32 codepoint) {
+    u32 size_bits;
+    memcpy(&size_bits, &size, sizeof(size_bits));
+
+    u32 h = codepoint * 0x9e3779b1u;
+    h ^= size_bits + 0x7f4a7c15u + (h << 6) + (h >> 2);
+    h ^= (u32) font * 0x85ebca6bu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h & (GLYPH_TABLE_CAPACITY - 1);
+}
+
+static glyph_entry_t* find_entry(glyph_entry_t* table, s32 font, f32 size, u32 codepoint) {
+    for (u32 i = glyph_hash(font, size, codepoint);; i = (i + 1) & (GLYPH_TABLE_CAPACITY - 1)) {
+        glyph_entry_t* entry = &table[i];
+
+        if (!entry->used) {
+            return entry;
+        }
+
+        if (entry->codepoint == codepoint && entry->size == size && entry->font == font) {
+            return entry;
+        }
+    }
+}
+
+const glyph_t* glyph_atlas_find(const glyph_atlas_t* atlas, s32 font, f32 size, u32 codepoint) {
+    glyph_entry_t* entry = find_entry(atlas->table, font, size, codepoint);
+    return entry->used ? &entry->glyph : NULL;
+}
+
+texture_t glyph_atlas_page_texture(const glyph_atlas_t* atlas, u16 page) {
+    assert(page < atlas->page_count);
+
+    return (texture_t) {
+        .data   = atlas->pages[page].pixels,
+        .width  = GLYPH_ATLAS_PAGE_SIZE,
+        .height = GLYPH_ATLAS_PAGE_SIZE,
+        .stride = GLYPH_ATLAS_PAGE_SIZE,
+        .format = TEXTURE_FORMAT_A8,
+    };
+}
+
+
+static void evict_page(glyph_atlas_t* atlas, s32 page_index) {
+    glyph_page_t* page = &atlas->pages[page_index];
+
+    //
+    // @Note: open addressing doesn't like holes, so rebuild the table without the glyphs of the page.
+    // Eviction happens once in a blue moon, it's not worth doing anything smarter.
+    //
+    glyph_entry_t* old = atlas->table;
+    atlas->table       = calloc(GLYPH_TABLE_CAPACITY, sizeof(glyph_entry_t));
+    atlas->glyph_count = 0;
+
+    for (s32 i = 0; i < GLYPH_TABLE_CAPACITY; i++) {
+        if (!old[i].used || old[i].glyph.page == page_index) continue;
+
+        *find_entry(atlas->table, old[i].font, old[i].size, old[i].codepoint) = old[i];
+        atlas->glyph_count += 1;
+    }
+    free(old);
+
+    stbtt_PackEnd(&page->pack);
+    memset(page->pixels, 0, GLYPH_ATLAS_PAGE_SIZE * GLYPH_ATLAS_PAGE_SIZE);
+    stbtt_PackBegin(&page->pack, page->pixels, GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE, 0, GLYPH_ATLAS_PADDING, NULL);
+
+    page->glyph_count = 0;
+    page->full        = false;
+    atlas->evictions += 1;
+}
+
+// Least recently used page that the current frame doesn't need, -1 if every page is in use.
+static s32 least_recently_used_page(glyph_atlas_t* atlas) {
+    s32 result = -1;
+
+    for (s32 i = 0; i < atlas->page_count; i++) {
+        glyph_page_t* page = &atlas->pages[i];
+        if (page->last_used_frame == atlas->frame) continue;
+
+        if (result == -1 || page->last_used_frame < atlas->pages[result].last_used_frame) {
+            result = i;
+        }
+    }
+
+    return result;
+}
+
+// Page with free space, grows the atlas first and evicts when it can't grow anymore.
+static s32 page_for_packing(glyph_atlas_t* atlas) {
+    for (s32 i = 0; i < atlas->page_count; i++) {
+        if (!atlas->pages[i].full) return i;
+    }
+
+    if (atlas->page_count < GLYPH_ATLAS_MAX_PAGES) {
+        glyph_page_t* page = &atlas->pages[atlas->page_count];
+        page->pixels = calloc(GLYPH_ATLAS_PAGE_SIZE * GLYPH_ATLAS_PAGE_SIZE, 1);
+        stbtt_PackBegin(&page->pack, page->pixels, GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE, 0, GLYPH_ATLAS_PADDING, NULL);
+
+        return atlas->page_count++;
+    }
+
+    s32 lru = least_recently_used_page(atlas);
+    if (lru != -1) {
+        evict_page(atlas, lru);
+    }
+    return lru;
+}
+
+static void add_glyph(glyph_atlas_t* atlas, s32 font, f32 size, u32 codepoint, s32 page_index, const stbtt_packedchar* packed) {
+    if (atlas->glyph_count + 1 > GLYPH_TABLE_CAPACITY * 3 / 4) {
+        s32 lru = least_recently_used_page(atlas);
+        if (lru == -1 || lru == page_index) {
+            return;
+        }
+        evict_page(atlas, lru);
+    }
+
+    glyph_entry_t* entry = find_entry(atlas->table, font, size, codepoint);
+    assert(!entry->used);
+
+    *entry = (glyph_entry_t) {
+        .font      = font,
+        .size      = size,
+        .codepoint = codepoint,
+        .used      = true,
+        .glyph     = {
+            .x0      = packed->x0,
+            .y0      = packed->y0,
+            .x1      = packed->x1,
+            .y1      = packed->y1,
+            .xoff    = packed->xoff,
+            .yoff    = packed->yoff,
+            .xoff2   = packed->xoff2,
+            .yoff2   = packed->yoff2,
+            .advance = packed->xadvance,
+            .page    = (u16) page_index,
+        },
+    };
+
+    atlas->glyph_count += 1;
+    atlas->pages[page_index].glyph_count += 1;
+    atlas->rasterized  += 1;
+}
+
+static void pack_glyphs(glyph_atlas_t* atlas, s32 font, f32 size, int* codepoints, s32 count) {
+    stbtt_packedchar packed[GLYPH_ATLAS_BATCH];
+
+    while (count > 0) {
+        s32 page_index = page_for_packing(atlas);
+        if (page_index == -1) {
+            log_warning(LOG_TEXT, "Glyph atlas is full, %d glyphs are not going to be drawn this frame.", count);
+            return;
+        }
+
+        glyph_page_t* page = &atlas->pages[page_index];
+        bool was_empty     = page->glyph_count == 0;
+
+        stbtt_pack_range range = {
+            .font_size                   = size,
+            .array_of_unicode_codepoints = codepoints,
+            .num_chars                   = count,
+            .chardata_for_range          = packed,
+        };
+        stbtt_PackFontRanges(&page->pack, atlas->fonts[font], 0, &range, 1);
+        page->last_used_frame = atlas->frame;
+
+        //
+        // @Note: glyphs that didn't fit are left zeroed, packed ones are never at x0 == 0 because of the padding.
+        // Keep whatever made it and try the rest on another page.
+        //
+        s32 left = 0;
+        for (s32 i = 0; i < count; i++) {
+            if (packed[i].x0 != 0) {
+                add_glyph(atlas, font, size, (u32) codepoints[i], page_index, &packed[i]);
+            } else {
+                codepoints[left++] = codepoints[i];
+            }
+        }
+
+        if (left > 0) {
+            page->full = true;
+
+            if (was_empty && left == count) {
+                log_warning(LOG_TEXT, "Glyphs of size %f don't fit into an empty atlas page.", (f64) size);
+                return;
+            }
+        }
+
+        count = left;
+    }
+}
+
+void glyph_atlas_prepare(glyph_atlas_t* atlas, s32 font, f32 size, const char* text) {
+    if (font < 0 || font >= atlas->font_count) {
+        return;
+    }
+
+    int missing[GLYPH_ATLAS_BATCH];
+    s32 missing_count = 0;
+
+    while (*text) {
+        u32 codepoint = next_codepoint(&text);
+        if (codepoint < 32) continue;
+
+        glyph_entry_t* entry = find_entry(atlas->table, font, size, codepoint);
+        if (entry->used) {
+            atlas->pages[entry->glyph.page].last_used_frame = atlas->frame;
+            continue;
+        }
+
+        bool seen = false;
+        for (s32 i = 0; i < missing_count && !seen; i++) {
+            seen = missing[i] == (int) codepoint;
+        }
+        if (seen) continue;
+
+        missing[missing_count++] = (int) codepoint;
+
+        if (missing_count == GLYPH_ATLAS_BATCH) {
+            pack_glyphs(atlas, font, size, missing, missing_count);
+            missing_count = 0;
+        }
+    }
+
+    if (missing_count > 0) {
+        pack_glyphs(atlas, font, size, missing, missing_count);
+    }
+}
+
+
+u32 next_codepoint(const char** text) {
+    const u8* s = (const u8*) *text;
+    u32 c = s[0];
+
+    s32 length = c < 0x80 ? 1 : (c >> 5) == 0x06 ? 2 : (c >> 4) == 0x0e ? 3 : (c >> 3) == 0x1e ? 4 : 0;
+    if (length == 0) {
+        *text += 1;
+        return 0xfffd;
+    }
+
+    u32 codepoint = length == 1 ? c : c & (0x7fu >> length);
+    for (s32 i = 1; i < length; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            *text += i;
+            return 0xfffd;
+        }
+        codepoint = (codepoint << 6) | (s[i] & 0x3f);
+    }
+
+    *text += length;
+    return codepoint;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "types.h"
+#include "texture.h"
+
+#include "stb_truetype.h"
+
+//
+// Glyph cache for text rendering.
+//
+// Glyphs are keyed by (font, size, codepoint) and rasterized the first time a string needs them,
+// packed with stbtt_PackFontRanges into fixed size pages. When every page is full a new one is added,
+// and once there are GLYPH_ATLAS_MAX_PAGES of them the least recently used page is thrown away and repacked.
+//
+// @Note: glyph_atlas_prepare is the only function that changes the atlas, it has to be called from the thread building the frame.
+// Lookups are read only, so tile threads can draw with the atlas while nobody is preparing.
+//
+
+enum {
+    GLYPH_ATLAS_PAGE_SIZE = 512,
+    GLYPH_ATLAS_MAX_PAGES = 8,
+    GLYPH_ATLAS_MAX_FONTS = 4,
+    GLYPH_ATLAS_PADDING   = 1,
+    GLYPH_ATLAS_BATCH     = 128, // @Note: glyphs packed with one stbtt_PackFontRanges call.
+
+    GLYPH_TABLE_CAPACITY  = 8192, // @Note: power of two, open addressing.
+};
+
+typedef struct {
+    u16 x0, y0, x1, y1;         // rect inside of the page bitmap.
+    f32 xoff, yoff;             // from the pen position to the top left corner of the bitmap.
+    f32 xoff2, yoff2;
+    f32 advance;
+    u16 page;
+} glyph_t;
+
+typedef struct {
+    s32 font;
+    f32 size;
+    u32 codepoint;
+    glyph_t glyph;
+    bool used;
+} glyph_entry_t;
+
+typedef struct {
+    u8* pixels;
+    stbtt_pack_context pack;
+
+    u64  last_used_frame;
+    s32  glyph_count;
+    bool full;
+} glyph_page_t;
+
+typedef struct glyph_atlas_t {
+    u8* fonts[GLYPH_ATLAS_MAX_FONTS]; // whole ttf files.
+    s32 font_count;
+
+    glyph_page_t pages[GLYPH_ATLAS_MAX_PAGES];
+    s32 page_count;
+
+    glyph_entry_t* table; // the metrics table, GLYPH_TABLE_CAPACITY entries.
+    s32 glyph_count;
+
+    u64 frame;
+
+    // Stats.
+    u64 rasterized;
+    u64 evictions;
+} glyph_atlas_t;
+
+void glyph_atlas_init(glyph_atlas_t* atlas);
+void glyph_atlas_free(glyph_atlas_t* atlas);
+
+//
+// @Note: returns -1 if the font couldn't be loaded.
+//
+s32 glyph_atlas_add_font(glyph_atlas_t* atlas, const char* path);
+
+//
+// Glyphs prepared after this call are not evicted until the next one.
+//
+void glyph_atlas_begin_frame(glyph_atlas_t* atlas);
+
+//
+// Rasterizes every glyph of a utf-8 string that isn't in the atlas yet.
+//
+void glyph_atlas_prepare(glyph_atlas_t* atlas, s32 font, f32 size, const char* text);
+
+//
+// @Note: NULL if the glyph wasn't prepared or didn't fit.
+//
+const glyph_t* glyph_atlas_find(const glyph_atlas_t* atlas, s32 font, f32 size, u32 codepoint);
+
+texture_t glyph_atlas_page_texture(const glyph_atlas_t* atlas, u16 page);
+
+//
+// Decodes one codepoint and advances text, invalid bytes come back as U+FFFD.
+//
+u32 next_codepoint(const char** text);
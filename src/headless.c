@@ -0,0 +1,102 @@
+#define _GNU_SOURCE
+#include "headless.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "stb_image_write.h"
+
+
+buffer_t allocate_headless_buffer(s32 width, s32 height) {
+    size_t size = (size_t) width * sizeof(uint32_t) * height;
+
+    //
+    // @Note: backed by a memfd, same as the buffers we share with the compositor, so that we measure the same kind of memory.
+    //
+    int fd = memfd_create("headless-framebuffer", MFD_CLOEXEC);
+    if (fd < 0) {
+        return (buffer_t) {};
+    }
+
+    int ret;
+    do {
+        ret = ftruncate(fd, size);
+    } while (ret < 0 && errno == EINTR);
+
+    uint32_t* data = ret == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return (buffer_t) {};
+    }
+
+    return (buffer_t) {
+        .data   = data,
+        .width  = width,
+        .height = height,
+    };
+}
+
+void free_headless_buffer(buffer_t* buffer) {
+    if (buffer->data) {
+        munmap(buffer->data, (size_t) buffer->width * sizeof(uint32_t) * buffer->height);
+    }
+    *buffer = (buffer_t) {};
+}
+
+
+typedef struct {
+    u8* data;
+    s32 size;
+    s32 capacity;
+} png_memory_t;
+
+static void append_png_bytes(void* context, void* data, int size) {
+    png_memory_t* memory = context;
+
+    if (memory->size + size > memory->capacity) {
+        memory->capacity = (memory->size + size) * 2;
+        memory->data     = realloc(memory->data, memory->capacity);
+    }
+
+    memcpy(memory->data + memory->size, data, size);
+    memory->size += size;
+}
+
+// XRGB8888 is stored as B, G, R, X bytes, png wants R, G, B.
+static u8* convert_to_rgb(buffer_t* buffer) {
+    u8* rgb = malloc((size_t) buffer->width * buffer->height * 3);
+
+    for (s32 i = 0; i < buffer->width * buffer->height; i++) {
+        u32 pixel = buffer->data[i];
+        rgb[i*3 + 0] = (pixel >> 16) & 0xFF;
+        rgb[i*3 + 1] = (pixel >> 8)  & 0xFF;
+        rgb[i*3 + 2] = (pixel >> 0)  & 0xFF;
+    }
+
+    return rgb;
+}
+
+u8* encode_buffer_png(buffer_t* buffer, s32* size) {
+    u8* rgb = convert_to_rgb(buffer);
+
+    png_memory_t memory = {};
+    stbi_write_png_to_func(append_png_bytes, &memory, buffer->width, buffer->height, 3, rgb, buffer->width * 3);
+    free(rgb);
+
+    *size = memory.size;
+    return memory.data;
+}
+
+bool write_buffer_png(buffer_t* buffer, const char* path) {
+    u8* rgb = convert_to_rgb(buffer);
+    int ok  = stbi_write_png(path, buffer->width, buffer->height, 3, rgb, buffer->width * 3);
+    free(rgb);
+
+    return ok != 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "render.h"
+
+//
+// Offscreen render target with the same memory layout as the wl_shm framebuffers, but no compositor behind it.
+//
+
+buffer_t allocate_headless_buffer(s32 width, s32 height);
+void free_headless_buffer(buffer_t* buffer);
+
+//
+// @Note: encoded PNG is malloc'ed, free it with free().
+//
+u8* encode_buffer_png(buffer_t* buffer, s32* size);
+bool write_buffer_png(buffer_t* buffer, const char* path);
@@ -0,0 +1,80 @@
+#include "layout.h"
+
+
+static void add_tab(ui_t* ui, s32 panel, f32 x, f32 y, f32 w, f32 h, const char* text) {
+    s32 tab = ui_add(ui, panel, (ui_node_t) {
+        .kind        = UI_NODE_TAB,
+        .x = x, .y = y, .w = w, .h = h,
+        .color       = LAYOUT_TAB_COLOR,
+        .hover_color = LAYOUT_TAB_HOVER_COLOR,
+    });
+
+    ui_add(ui, tab, (ui_node_t) { // @Incomplete: query text size first and size the tab after it.
+        .kind  = UI_NODE_LABEL,
+        .x     = x + 0.005f,
+        .y     = y + 0.004f,
+        .text  = text,
+        .color = 0xffffffff,
+    });
+}
+
+void build_layout(ui_t* ui) {
+    // brown editor: #3f3f3f
+    // brown highlight line editor: #4f4f4f
+    // black windows: #111111
+    // black highlight line windows: #1f1f1f
+    // yellow status bar: #774f00
+    //
+
+    // @Note: this is terribly inefficient... z buffer?
+    s32 background = ui_add(ui, UI_ROOT, (ui_node_t) {
+        .kind  = UI_NODE_PANEL,
+        .x = 0.0f, .y = 0.0f,
+        .w = 0.999f, .h = 0.999f, // @Incomplete: handle 1.0f.
+        .color = 0xff774f00,
+    });
+
+    s32 editor = ui_add(ui, background, (ui_node_t) {
+        .kind  = UI_NODE_PANEL,
+        .x = 0.00f, .y = 0.25f, .w = 0.45f, .h = 0.7f,
+        .color = 0xff3f3f3f,
+    });
+
+    ui_add(ui, editor, (ui_node_t) { // breakpoint on an editor window :)
+        .kind  = UI_NODE_MARKER,
+        .x = 0.01f, .y = 0.4f, .r = 0.01f,
+        .color = 0xffdb0f10,
+    });
+
+    ui_add(ui, background, (ui_node_t) { // disassembly window.
+        .kind  = UI_NODE_PANEL,
+        .x = 0.0f, .y = 0.0f, .w = 0.45f, .h = 0.24f,
+        .color = 0xff3f3f3f,
+    });
+
+    s32 watch = ui_add(ui, background, (ui_node_t) {
+        .kind  = UI_NODE_PANEL,
+        .x = 0.46f, .y = 0.4f, .w = 0.53f, .h = 0.55f,
+        .color = 0xff111111,
+    });
+
+    s32 call_stack = ui_add(ui, background, (ui_node_t) {
+        .kind  = UI_NODE_PANEL,
+        .x = 0.46f, .y = 0.0f, .w = 0.53f, .h = 0.39f,
+        .color = 0xff111111,
+    });
+
+    f32 bar_x = 0.46f;
+    f32 bar_y = 0.918f;
+    add_tab(ui, watch, bar_x, bar_y, 0.075f, 0.03f, "Watch");
+
+    bar_x += 0.078f;
+    add_tab(ui, watch, bar_x, bar_y, 0.1f, 0.03f, "Registers");
+
+    bar_x = 0.46f;
+    bar_y = 0.358f;
+    add_tab(ui, call_stack, bar_x, bar_y, 0.11f, 0.03f, "Call Stack");
+
+    bar_x += 0.115f;
+    add_tab(ui, call_stack, bar_x, bar_y, 0.12f, 0.03f, "Breakpoints");
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "ui.h"
+
+enum {
+    LAYOUT_TAB_COLOR       = 0xff22436b,
+    LAYOUT_TAB_HOVER_COLOR = 0xff2f5688,
+};
+
+//
+// Debugger window layout: panels, tab bars and their labels, added under the root of the ui.
+//
+void build_layout(ui_t* ui);
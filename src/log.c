@@ -0,0 +1,290 @@
+#include "log.h"
+#include "base.h"
+#include "stb_sprintf.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+static logger_t logger;
+
+static const char* level_names[] = {
+    [LOG_DEBUG]   = "debug",
+    [LOG_INFO]    = "info",
+    [LOG_WARNING] = "warning",
+    [LOG_ERROR]   = "error",
+};
+
+static const char* category_names[LOG_CATEGORY_COUNT] = {
+    [LOG_GENERAL] = "general",
+    [LOG_WAYLAND] = "wayland",
+    [LOG_RENDER]  = "render",
+    [LOG_TEXT]    = "text",
+    [LOG_MEMORY]  = "memory",
+};
+
+enum {
+    LOG_PREFIX_SIZE = 48,
+};
+
+static u64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+// Returns whether the message had to be cut off.
+static bool fill_record(log_record_t* record, log_level_t level, log_category_t category, const char* fmt, va_list va) {
+    record->time     = now_ns() - logger.start;
+    record->level    = (u8) level;
+    record->category = (u8) category;
+
+    // @Note: returns the length of the whole message, even when only a part of it fits.
+    int full   = stbsp_vsnprintf(record->text, LOG_MAX_MESSAGE - 1, fmt, va);
+    int length = clamp(full, 0, LOG_MAX_MESSAGE - 2);
+
+    record->text[length] = '\n';
+    record->length       = (u16) (length + 1);
+    return full > length;
+}
+
+static int format_prefix(char* prefix, const log_record_t* record) {
+    return stbsp_snprintf(prefix, LOG_PREFIX_SIZE, "[%10.6f] %s %s: ",
+                          (f64) record->time / 1e9, level_names[record->level], category_names[record->category]);
+}
+
+// Every byte of the iovecs, unless the fd fails. Returns false then.
+static bool write_all(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        atomic_fetch_add_explicit(&logger.writes, 1, memory_order_relaxed);
+
+        // @Note: pipes and terminals can take only a part of it.
+        while (count > 0 && (size_t) written >= iov->iov_len) {
+            written -= (ssize_t) iov->iov_len;
+            iov     += 1;
+            count   -= 1;
+        }
+        if (count > 0) {
+            iov->iov_base = (u8*) iov->iov_base + written;
+            iov->iov_len -= (size_t) written;
+        }
+    }
+    return true;
+}
+
+// Writes out what the ring has, in batches. Returns how many records there were.
+static u32 flush_ring(log_ring_t* ring) {
+    static char prefixes[LOG_BATCH][LOG_PREFIX_SIZE];
+    static struct iovec iov[2 * LOG_BATCH];
+
+    u32 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    u32 flushed = 0;
+    while (head != tail) {
+        u32 batch = min(tail - head, (u32) LOG_BATCH);
+
+        for (u32 i = 0; i < batch; i++) {
+            const log_record_t* record = &ring->records[(head + i) & (LOG_RING_CAPACITY - 1)];
+
+            iov[2 * i]     = (struct iovec) { .iov_base = prefixes[i],           .iov_len = (size_t) format_prefix(prefixes[i], record) };
+            iov[2 * i + 1] = (struct iovec) { .iov_base = (void*) record->text, .iov_len = record->length };
+        }
+
+        // @Note: on a write error the batch is gone anyway, the ring must not fill up behind it.
+        write_all(logger.fd, iov, (int) (2 * batch));
+
+        // @Note: release, the owner can reuse the records once it sees the new head.
+        head += batch;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+
+        flushed += batch;
+    }
+
+    atomic_fetch_add_explicit(&logger.records, flushed, memory_order_relaxed);
+    return flushed;
+}
+
+static u32 flush_rings() {
+    u32 flushed = 0;
+
+    s32 count = min(atomic_load(&logger.ring_count), (s32) LOG_MAX_THREADS);
+    for (s32 i = 0; i < count; i++) {
+        log_ring_t* ring = atomic_load_explicit(&logger.rings[i], memory_order_acquire);
+        if (ring) { // @Note: NULL while the thread is still setting it up.
+            flushed += flush_ring(ring);
+        }
+    }
+    return flushed;
+}
+
+static void sleep_ms(u32 ms) {
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long) (ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static void* flush_main(void* data) {
+    u32 interval = LOG_FLUSH_INTERVAL_MS;
+
+    while (!atomic_load(&logger.quit)) {
+        // @Note: polls, so that logging never has to wake anybody up.
+        if (flush_rings() > 0) {
+            interval = LOG_FLUSH_INTERVAL_MS;
+        } else {
+            interval = min(interval * 2, (u32) LOG_IDLE_INTERVAL_MS);
+        }
+        sleep_ms(interval);
+    }
+
+    flush_rings();
+    return NULL;
+}
+
+static log_ring_t* thread_ring() {
+    // @Note: rings are never freed, the threads that own them keep pointing at them.
+    static thread_local log_ring_t* ring    = NULL;
+    static thread_local bool        no_ring = false;
+
+    if (ring || no_ring) {
+        return ring;
+    }
+
+    s32 index = atomic_fetch_add(&logger.ring_count, 1);
+    if (index >= LOG_MAX_THREADS) {
+        no_ring = true;
+        return NULL;
+    }
+
+    ring = aligned_alloc(alignof(log_ring_t), sizeof(log_ring_t));
+    if (ring == NULL) {
+        no_ring = true;
+        return NULL;
+    }
+    memset(ring, 0, sizeof(log_ring_t));
+
+    atomic_store_explicit(&logger.rings[index], ring, memory_order_release);
+    return ring;
+}
+
+bool log_init(const char* path) {
+    assert(!logger.started);
+
+    logger = (logger_t) {
+        .fd    = STDOUT_FILENO,
+        .start = now_ns(),
+    };
+
+    if (path) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "Couldn't open the log file '%s': %s\n", path, strerror(errno));
+            return false;
+        }
+        logger.fd      = fd;
+        logger.owns_fd = true;
+    }
+
+    // @Note: whatever went through stdio before this shows up before the records.
+    fflush(stdout);
+
+    if (pthread_create(&logger.thread, NULL, flush_main, NULL) != 0) {
+        fprintf(stderr, "Couldn't start the log thread.\n");
+        if (logger.owns_fd) close(logger.fd);
+        return false;
+    }
+
+    logger.started = true;
+    return true;
+}
+
+void log_shutdown() {
+    if (!logger.started) {
+        return;
+    }
+
+    atomic_store(&logger.quit, true);
+    pthread_join(logger.thread, NULL);
+
+    if (logger.owns_fd) {
+        close(logger.fd);
+    }
+    logger.started = false;
+}
+
+log_stats_t log_stats() {
+    log_stats_t stats = {
+        .records = atomic_load(&logger.records),
+        .writes  = atomic_load(&logger.writes),
+        .dropped = atomic_load(&logger.dropped),
+    };
+
+    s32 count = min(atomic_load(&logger.ring_count), (s32) LOG_MAX_THREADS);
+    for (s32 i = 0; i < count; i++) {
+        log_ring_t* ring = atomic_load_explicit(&logger.rings[i], memory_order_acquire);
+        if (ring) {
+            stats.dropped   += atomic_load_explicit(&ring->dropped,   memory_order_relaxed);
+            stats.truncated += atomic_load_explicit(&ring->truncated, memory_order_relaxed);
+        }
+    }
+    return stats;
+}
+
+void log_write(log_level_t level, log_category_t category, const char* fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+
+    if (!logger.started) {
+        // Written right away, through stdio so that it stays in order with print.
+        log_record_t record;
+        fill_record(&record, level, category, fmt, va);
+
+        char prefix[LOG_PREFIX_SIZE];
+        int  prefix_length = format_prefix(prefix, &record);
+
+        flockfile(stdout);
+        fwrite(prefix, 1, (size_t) prefix_length, stdout);
+        fwrite(record.text, 1, record.length, stdout);
+        funlockfile(stdout);
+
+        va_end(va);
+        return;
+    }
+
+    log_ring_t* ring = thread_ring();
+    if (ring == NULL) {
+        atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);
+        va_end(va);
+        return;
+    }
+
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == LOG_RING_CAPACITY) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        va_end(va);
+        return;
+    }
+
+    log_record_t* record = &ring->records[tail & (LOG_RING_CAPACITY - 1)];
+    if (fill_record(record, level, category, fmt, va)) {
+        atomic_fetch_add_explicit(&ring->truncated, 1, memory_order_relaxed);
+    }
+
+    // @Note: release, the flush thread sees the record before it sees the new tail.
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    va_end(va);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "types.h"
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+//
+// Asynchronous logging: log_write formats the message into a record of the calling thread's ring and returns,
+// a background thread takes the records out of all of the rings and writes them out in batches with writev.
+//
+// Every thread that logs gets its own single producer, single consumer ring the first time it logs, after that logging
+// doesn't lock, wait or make a syscall. When a ring is full the record is dropped and counted instead of blocking,
+// so a stuck terminal or a slow file can't stall the thread that logs.
+//
+// Messages below LOG_MIN_LEVEL are compiled out, the calls are dead code then.
+//
+// @Note: before log_init and after log_shutdown records are written to stdout right away, this is what the replay does.
+// Whatever is still in the rings when the process crashes is lost.
+//
+
+typedef enum {
+    LOG_DEBUG = 0,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR,
+} log_level_t;
+
+typedef enum {
+    LOG_GENERAL = 0,
+    LOG_WAYLAND,
+    LOG_RENDER,
+    LOG_TEXT,
+    LOG_MEMORY,
+
+    LOG_CATEGORY_COUNT,
+} log_category_t;
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_INFO
+#endif
+
+enum {
+    LOG_MAX_THREADS   = 32,
+    LOG_RING_CAPACITY = 256, // @Note: records per thread, power of two.
+    LOG_RECORD_SIZE   = 512,
+    LOG_MAX_MESSAGE   = LOG_RECORD_SIZE - 16, // longer messages are cut off, with the newline.
+
+    LOG_BATCH = 128, // records per writev.
+
+    LOG_FLUSH_INTERVAL_MS = 10,
+    LOG_IDLE_INTERVAL_MS  = 100, // the flush thread backs off up to this while nothing is logged.
+};
+
+typedef struct {
+    u64 time;     // ns since log_init.
+    u8  level;
+    u8  category;
+    u16 length;   // of text, with the newline.
+    char text[LOG_MAX_MESSAGE];
+} log_record_t;
+
+typedef struct {
+    log_record_t records[LOG_RING_CAPACITY];
+
+    // @Note: on their own cache lines, each of them is only written by one side.
+    alignas(64) atomic_uint head; // written by the flush thread.
+    alignas(64) atomic_uint tail; // written by the thread that owns the ring.
+
+    atomic_uint_fast64_t dropped;   // the ring was full.
+    atomic_uint_fast64_t truncated; // didn't fit into LOG_MAX_MESSAGE.
+} log_ring_t;
+
+typedef struct {
+    u64 records;   // written out.
+    u64 writes;    // writev calls.
+    u64 dropped;   // records thrown away because a ring was full or there were more than LOG_MAX_THREADS threads logging.
+    u64 truncated;
+} log_stats_t;
+
+typedef struct {
+    atomic_bool started;
+    int  fd;
+    bool owns_fd;
+    u64  start;
+
+    _Atomic(log_ring_t*) rings[LOG_MAX_THREADS];
+    atomic_int ring_count;
+
+    pthread_t  thread;
+    atomic_bool quit;
+
+    atomic_uint_fast64_t records;
+    atomic_uint_fast64_t writes;
+    atomic_uint_fast64_t dropped; // records of threads that didn't get a ring.
+} logger_t;
+
+//
+// path is where the records go, stdout when NULL.
+//
+bool log_init(const char* path);
+
+//
+// Writes out everything that was logged so far and stops the flush thread.
+//
+void log_shutdown();
+
+log_stats_t log_stats();
+
+void log_write(log_level_t level, log_category_t category, const char* fmt, ...);
+
+#define log_at(level, category, ...) do { if ((level) >= LOG_MIN_LEVEL) log_write((level), (category), __VA_ARGS__); } while (0)
+
+#define log_debug(category, ...)   log_at(LOG_DEBUG,   (category), __VA_ARGS__)
+#define log_info(category, ...)    log_at(LOG_INFO,    (category), __VA_ARGS__)
+#define log_warning(category, ...) log_at(LOG_WARNING, (category), __VA_ARGS__)
+#define log_error(category, ...)   log_at(LOG_ERROR,   (category), __VA_ARGS__)
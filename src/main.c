@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <dlfcn.h>
 #include <pthread.h>
+#include <math.h>
 
 #include <linux/input-event-codes.h>
 
@@ -18,318 +19,43 @@
 #include "wayland/protocols/xdg-decoration.h"
 #include "wayland/protocols/tablet.h"
 #include "wayland/protocols/cursor-shape.h"
+#include "wayland/protocols/viewporter.h"
+#include "wayland/protocols/fractional-scale.h"
 #include "wayland/libdecor.h"
 
 #include "types.h"
+#include "base.h"
 #include "print.h"
 #include "temporary_storage.h"
+#include "render.h"
+#include "tile_renderer.h"
+#include "frame.h"
+#include "ui.h"
+#include "layout.h"
+#include "framebuffer.h"
+#include "frame_scheduler.h"
+#include "profiler.h"
+#include "render_thread.h"
+#include "log.h"
 
 
-#define STB_TRUETYPE_IMPLEMENTATION
-#include "stb_truetype.h"
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
-#define min(a, b) (((a) < (b)) ? (a) : (b))
-#define max(a, b) (((a) > (b)) ? (a) : (b))
-#define clamp(x, a, b) (min(max(x, a), b))
-#define lerp(a, b, t) ((a) + ((b)-(a)) * (t))
-
 //
 // @TODO:
 // !! load a file in the debugger, and load a file into the editor.
 // !! allow scrolling the file in the editor and setting breakpoints (visually + gdb) on the side.
-// !! refactor (draw scene) create virtual representation of all of these boxes, so that we can interact with them separately from update().
-// !! implement simple UI system with dirty rectangles, and interactive boxes
 //
-// .. blend circles correctly
-// .. remove old blend function.
-// .. refactor draw_textured_box_internal and pass texture there instead of uint8_t* bitmap
 // !! Once we have reasonable UI defaults we can start parsing GDB commands.
 //
 // !! hot realoding
 //
 
 
-typedef struct {
-    float r, g, b, a;
-} color_t;
-
-typedef struct {
-    s32 x, y, w, h;
-} rectangle_t;
-
-typedef struct {
-    s32 x, y, w, h;
-} Rect_s32;
-
-typedef struct {
-    f32 x, y, w, h;
-} Rect_f32;
-
-typedef struct {
-    f32 x, y, r;
-} Circle_f32;
-
-typedef struct {
-    s32 x, y, r;
-} Circle_s32;
-
-typedef struct buffer_t {
-    uint32_t* data;
-    int32_t width, height;
-    struct wl_buffer* buffer;
-} buffer_t;
-
-static float ortho_projection_f1;
-static float ortho_projection_f2;
-static void update_orthographic_projection(int32_t width, int32_t height) {
-    ortho_projection_f1 = width;
-    ortho_projection_f2 = height;
-}
-
-static bool valid_orthographic_projection() {
-    return ortho_projection_f1 != 0.0f && ortho_projection_f2 != 0.0f;
-}
-
-static void transform_screen_into_world(double* x, double* y) {
-    *x =         *x / ortho_projection_f1;
-    *y = 1.0f - (*y / ortho_projection_f2);
-}
-
-static void transform_world_into_screen(float* x, float* y) {
-    *x = *x          * ortho_projection_f1;
-    *y = (1.0f - *y) * ortho_projection_f2;
-}
-
-static void transform_world_into_screen_rect(float* x, float* y, float* w, float* h) {
-
-    float origin_x = *x;
-    float origin_y = *y;
-
-    *x = clamp(*x, 0.0f, 1.0f);
-    *y = clamp(*y, 0.0f, 1.0f);
-    *w = clamp(*w, 0.0f, 1.0f);
-    *h = clamp(*h, 0.0f, 1.0f);
-
-
-    *x =       *x  * ortho_projection_f1;
-    *y = (1.0f-*y) * ortho_projection_f2;
-    *w =       *w  * ortho_projection_f1;
-    *h =       *h  * ortho_projection_f2;
-
-    if (origin_x == 1.0f) { // since we are writing into our buffer, we don't want to include the very last bit.
-        *x -= 1;
-    }
-
-    if (origin_y == 0.0f) {
-        *y -= 1;
-    }
-}
-
-static void transform_world_into_screen_circle(float* x, float* y, float* r) {
-
-    float origin_x = *x;
-    float origin_y = *y;
-
-    *x = clamp(*x, 0.0f, 1.0f);
-    *y = clamp(*y, 0.0f, 1.0f);
-    *r = clamp(*r, 0.0f, 1.0f);
-
-    *x =       *x  * ortho_projection_f1;
-    *y = (1.0f-*y) * ortho_projection_f2;
-    *r =       *r  * min(ortho_projection_f1, ortho_projection_f2);
-
-    if (origin_x == 1.0f) { // since we are writing into our buffer, we don't want to include the very last bit.
-        *x -= 1;
-    }
-
-    if (origin_y == 0.0f) {
-        *y -= 1;
-    }
-}
-
-static void transform_screen_into_world_disk(float* x, float* y, float* r0, float* r1) {
-
-    f32 origin_x = *x;
-    f32 origin_y = *y;
-
-    *x  = clamp(*x,  0.0f, 1.0f);
-    *y  = clamp(*y,  0.0f, 1.0f);
-    *r0 = clamp(*r0, 0.0f, 1.0f);
-    *r1 = clamp(*r1, 0.0f, 1.0f);
-
-    *x  =       *x  * ortho_projection_f1;
-    *y  = (1.0f-*y) * ortho_projection_f2;
-    *r0 =      *r0  * min(ortho_projection_f1, ortho_projection_f2);
-    *r1 =      *r1  * min(ortho_projection_f1, ortho_projection_f2);
-
-    if (origin_x == 1.0f) { // since we are writing into our buffer, we don't want to include the very last bit.
-        *x -= 1.0f;
-    }
-
-    if (origin_y == 0.0f) {
-        *y -= 1.0f;
-    }
-}
-
-
-static uint32_t make_u32_from_color(color_t color) {
-    uint32_t aa = (uint8_t) (color.a * 255.0f);
-    uint32_t rr = (uint8_t) (color.r * 255.0f);
-    uint32_t gg = (uint8_t) (color.g * 255.0f);
-    uint32_t bb = (uint8_t) (color.b * 255.0f);
-
-    return (aa << 24) | (rr << 16) | (gg << 8) | (bb << 0);
-}
-
-
-static uint32_t make_u32_from_u8(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-    uint32_t aa = a;
-    uint32_t rr = r;
-    uint32_t gg = g;
-    uint32_t bb = b;
-
-    return (aa << 24) | (rr << 16) | (gg << 8) | (bb << 0);
-}
-
-
-static void memset4(void* data, uint32_t value, uint32_t size) {
-    uint32_t* ptr = data;
-    for (uint32_t i = 0; i < size; i++) {
-        ptr[i] = value;
-    }
-}
-
-static void set_pixel(buffer_t* b, uint32_t x, uint32_t y, uint32_t c) {
-    b->data[y * b->width + x] = c;
-}
-
-static u32 blend_color_new(u32 background, u32 foreground, float alpha) {
-
-    float foreground_r;
-    float foreground_g;
-    float foreground_b;
-    {
-        u32 color = foreground;
-        uint8_t aa = (color >> 24) & 0xFF;
-        uint8_t rr = (color >> 16) & 0xFF;
-        uint8_t gg = (color >> 8)  & 0xFF;
-        uint8_t bb = (color >> 0)  & 0xFF;
-
-        foreground_r = rr / 255.0f;
-        foreground_g = gg / 255.0f;
-        foreground_b = bb / 255.0f;
-    }
-
-    float background_r;
-    float background_g;
-    float background_b;
-    {
-        u32 color = background;
-        uint8_t aa = (color >> 24) & 0xFF;
-        uint8_t rr = (color >> 16) & 0xFF;
-        uint8_t gg = (color >> 8)  & 0xFF;
-        uint8_t bb = (color >> 0)  & 0xFF;
-
-        background_r = rr / 255.0f;
-        background_g = gg / 255.0f;
-        background_b = bb / 255.0f;
-    }
-
-    color_t c = {
-        .r = background_r * (1.0f - alpha) + foreground_r * alpha,
-        .g = background_g * (1.0f - alpha) + foreground_g * alpha,
-        .b = background_b * (1.0f - alpha) + foreground_b * alpha,
-        .a = 1.0f,
-    };
-
-    return make_u32_from_color(c);
-}
-
-static u32 blend_color_with_background(u32 color, float intensity) {
-    // @Incomplete: add background color to lerp against.
-
-    uint8_t aa = (color >> 24) & 0xFF;
-    uint8_t rr = (color >> 16) & 0xFF;
-    uint8_t gg = (color >> 8)  & 0xFF;
-    uint8_t bb = (color >> 0)  & 0xFF;
-
-    float a = aa / 255.0f;
-    float r = rr / 255.0f;
-    float g = gg / 255.0f;
-    float b = bb / 255.0f;
-
-    color_t c = {
-        .r = r * intensity,
-        .g = g * intensity,
-        .b = b * intensity,
-        .a = 1.0f,
-    };
-
-    return make_u32_from_color(c);
-}
-
-
-typedef enum {
-    COMMAND_TYPE_NONE = 0,
-    COMMAND_TYPE_DRAW_EVERYTHING,
-    COMMAND_TYPE_DRAW_BOX,
-    COMMAND_TYPE_DRAW_CIRCLE,
-    COMMAND_TYPE_DRAW_DISK,
-} command_type_t;
-
-typedef struct {
-    command_type_t type;
-    union {
-        struct {
-            float x, y, w, h;
-            u32 color;
-        } box;
-
-        struct {
-            float x, y;
-            float r;
-            u32 color;
-        } circle;
-
-        struct {
-            float x, y;
-            float r0, r1;
-            u32 color;
-        } disk;
-    };
-
-} command_t;
-
 enum {
-    MAX_RENDERING_COMMANDS = 32,
-};
-
-typedef struct {
-
-    // @Incomplete: if we are not rendering fast enough, we might get more stuff into commands array than we expect and crash on an assert...
-
-    command_t commands[MAX_RENDERING_COMMANDS];
-    int32_t length;
+    COMMAND_PRESSURE_WARNING = 1024, // @Note: pending commands per frame, above this we are probably not keeping up with the input.
 
-} command_buffer_t;
-
-static const buffer_t empty = {};
-
-
-typedef struct {
-    float x, y, w, h;
-
-    // @Incomplete: color here?
-
-    bool hovered; // @Incomplete: move this into general ui context.
-
-    // bool hover_just_activated;   // dirty flag.
-    // bool hover_just_deactivated; // dirty flag.
-
-} button_t;
+    REDUCED_SCALE_PERCENT = 50, // of the preferred scale, in low power mode and while resizing. The viewporter upscales it.
+    FRACTIONAL_SCALE_DENOMINATOR = 120,
+};
 
 typedef struct {
     struct wl_compositor* compositor;
@@ -348,19 +74,28 @@ typedef struct {
 
     struct wl_surface* current_surface;
 
-    buffer_t buffer;
-    buffer_t used_by_compositor;
-    buffer_t request_destruction;
+    framebuffer_manager_t framebuffers;
+    frame_scheduler_t     scheduler;
 
+    memory_arena_t   command_arena;
     command_buffer_t command_buffer;
+    frame_t          frame;
+    tile_renderer_t  tile_renderer;
+    render_thread_t  render_thread;
+    bool frame_in_flight; // built and submitted, the render thread is drawing it. Its buffer, frame and the framebuffers are off limits.
 
-    button_t button;
+    ui_t ui;
 
     struct wp_cursor_shape_manager_v1* cursor_shape_manager;
     struct wp_cursor_shape_device_v1* cursor_shape_device;
 
     struct zxdg_decoration_manager_v1* xdg_decoration_manager;
 
+    struct wp_viewporter* viewporter;
+    struct wp_viewport*   viewport;
+    struct wp_fractional_scale_manager_v1* fractional_scale_manager;
+    struct wp_fractional_scale_v1*         fractional_scale;
+
 #ifdef HAS_LIBDECOR
     struct libdecor* context;
     struct libdecor_frame* frame;
@@ -375,9 +110,29 @@ typedef struct {
     u32 width;
     u32 height;
 
+    // @Note: @SluggishResize: configure events only record what they ask for, it's applied once per frame right before drawing.
+    bool configured;       // nothing can be attached before the first configure.
+    bool configure_pending;
+    u32  configure_serial;
+    bool resize_pending;
+    bool resizing;         // interactive resize, the framebuffers over-allocate for it.
+    u32  pending_width;
+    u32  pending_height;
+
+    // @Note: width and height are in surface pixels, the buffer is scale times bigger than that.
+    f32  preferred_scale;  // buffer pixels per surface pixel that the compositor asked for.
+    bool has_fractional_scale;
+    bool has_preferred_buffer_scale;
+    bool low_power;        // always render at the reduced scale.
+    f32  buffer_scale;     // what the current buffers are rendered at.
+
+    bool show_profiler;    // draws the frame timing overlay, see profiler_add_overlay.
+
     u32 cursor_x;
     u32 cursor_y;
 
+    enum wp_cursor_shape_device_v1_shape cursor_shape;
+
     bool request_quit;
 } client_state_t;
 
@@ -390,560 +145,182 @@ static bool is_libdecor_surface(client_state_t* state) {
     return state->surface != state->current_surface; // @Note: assuming we only have two surfaces per application.
 }
 
-static bool buffer_is_ready_for_drawing(client_state_t* state) {
-    return state->buffer.buffer != NULL && state->used_by_compositor.buffer == NULL;
-}
-
-static void check_buffer_is_not_used_by_the_compositor(client_state_t* state) {
-    assert(state->buffer.buffer             != NULL);
-    assert(state->used_by_compositor.buffer == NULL);
-}
-
-static void draw_textured_box_internal(buffer_t* buffer, uint8_t* bitmap, f32 x0, f32 y0, f32 x1, f32 y1, f32 u0, f32 v0, f32 u1, f32 v1, u32 c) {
-    // @Incomplete: path texture width/height.
-    //
-
-    if (x0 == x1 && y0 == y1) {
-        return;
-    }
-
-    f32 w = x1 - x0;
-    f32 h = y1 - y0;
-
-    assert(w >= 0.0f);
-    assert(h >= 0.0f);
-
-    for (s32 y = (s32) y0; y < y1; y++) {
-        for (s32 x = (s32) x0; x <= x1; x++) {
-
-            f32 u = u0 + (x-x0) * (u1 - u0) / w;
-            f32 v = v0 + (y-y0) * (v1 - v0) / h;
-
-            s32 index = (s32) (u*512.f + 512.f * v * 512.f);
-            u8 pixel = bitmap[index];
-
-            uint32_t background = buffer->data[y * buffer->width + x];
-
-            float alpha = pixel / 255.0f;
-            u32 color = blend_color_new(background, c, alpha);
-
-            set_pixel(buffer, (s32) x, (s32) y, color);
-        }
+//
+// Buffer pixels per surface pixel for the next frame.
+//
+static f32 render_scale(client_state_t* state) {
+    if (state->viewport == NULL) {
+        // @Note: without a viewport the buffer can only be an integer multiple of the surface, see wl_surface_set_buffer_scale.
+        return max(floorf(state->preferred_scale + 0.5f), 1.0f);
     }
-}
 
-static void draw_box_internal(buffer_t* buffer, s32 x, s32 y, s32 w, s32 h, u32 c) {
-    //
-    // @Incomplete: check_buffer_is_not_used_by_the_compositor. Same for all other draw_* functions.
-    //
-
-    s32 orig_y = y;
-    for (y = orig_y; y >= orig_y-h; y--) {
-        memset4(buffer->data + (y * buffer->width + x), c, w);
+    f32 scale = state->preferred_scale;
+    if (state->low_power || state->resizing) {
+        scale = scale * REDUCED_SCALE_PERCENT / 100.0f;
     }
+    return scale;
 }
 
-static void draw_box(buffer_t* buffer, float x, float y, float w, float h, u32 c, rectangle_t* bounding) {
-
-    transform_world_into_screen_rect(&x, &y, &w, &h);
-    s32 x0 = (s32) x;
-    s32 y0 = (s32) y;
-    s32 w0 = (s32) w;
-    s32 h0 = (s32) h;
-
-    if (bounding) {
-        *bounding = (rectangle_t) {
-            .x = x0,
-            .y = y0 - h0,
-            .w = w0,
-            .h = h0,
-        };
+//
+// false when the framebuffers couldn't grow, they keep drawing at the old size and scale then.
+//
+static bool reallocate_framebuffer(client_state_t* state, int width, int height, f32 scale) {
+    PROFILE_BEGIN(resize);
+    bool resized = framebuffer_resize(&state->framebuffers, scale_to_buffer(width, scale), scale_to_buffer(height, scale));
+    PROFILE_END(resize, PROFILE_ALLOCATE);
+
+    if (!resized) {
+        log_warning(LOG_WAYLAND, "Staying at %dx%d, couldn't reallocate the framebuffers for %dx%d.", state->width, state->height, width, height);
+        return false;
     }
 
-    draw_box_internal(buffer, x0, y0, w0, h0, c);
-}
-
-static void draw_circle_internal(buffer_t* buffer, s32 x0, s32 y0, s32 r, u32 c) {
-    //
-    // @Incomplete: Implement Wu's circle algorithm instead of this crap.
-    //
+    state->width        = width;
+    state->height       = height;
+    state->buffer_scale = scale;
 
-    float r_inner = r*r - r; // Approximation of (r - 0.5)^2 = r*r - 2*r + 0.25 = r*r - r
-    float r_outer = r*r + r; // Approximation of (r + 0.5)^2 = r*r + 2*r + 0.25 = r*r + r
-    for (s32 y = y0-r; y <= y0+r; y++) {
-        float sqy = (y-y0) * (y-y0);
+    update_orthographic_projection(width, height, scale);
 
-        for (s32 x = x0-r; x <= x0+r; x++) {
-            float distance = (x-x0) * (x-x0) + sqy;
-
-            float intensity = (r_outer-distance+0.5f) / (2.0f*r); // +0.5f to round up.
-            u32 i0_ = blend_color_with_background(c, intensity);
-
-            bool inner = distance <= r_inner;
-            bool outer = distance > r_inner && distance < r_outer;
-            if (inner) {
-                set_pixel(buffer, x, y, c);
-                continue;
-            }
-
-            if (outer) {
-                set_pixel(buffer, x, y, i0_);
-                continue;
-            }
-        }
+    // @Note: both are double buffered, they apply with the commit of the first frame drawn at the new size.
+    if (state->viewport) {
+        wp_viewport_set_destination(state->viewport, width, height);
+    } else {
+        wl_surface_set_buffer_scale(state->surface, (int32_t) scale);
     }
+    return true;
 }
 
-static void draw_circle(buffer_t* buffer, float x, float y, float r, u32 c, rectangle_t* bounding) {
-
-    transform_world_into_screen_circle(&x, &y, &r);
-    s32 x0 = (s32) x;
-    s32 y0 = (s32) y;
-    s32 r0 = (s32) r;
-
-    if (bounding) {
-        *bounding = (rectangle_t) {
-            .x = x0 - r0,
-            .y = y0 - r0,
-            .w = r0 * 2,
-            .h = r0 * 2,
-        };
+static void set_preferred_scale(client_state_t* state, f32 scale) {
+    if (scale > 0.0f && scale != state->preferred_scale) {
+        state->preferred_scale = scale;
+        state->resize_pending  = true;
+        frame_scheduler_request(&state->scheduler);
     }
-
-    draw_circle_internal(buffer, x0, y0, r0, c);
 }
 
-static void draw_disk_internal(buffer_t* buffer, s32 x0, s32 y0, s32 r0, s32 r1, u32 c) {
-    assert(r0 < r1 && "Inner radius should be always less than outer radius");
-
-    float r0_inner = r0*r0 - r0;
-    float r0_outer = r0*r0 + r0;
-
-    float r1_inner = r1*r1 - r1;
-    float r1_outer = r1*r1 + r1;
-
-    for (s32 y = y0-r1; y <= y0+r1; y++) {
-        s32 sqy = (y-y0) * (y-y0);
-
-        for (s32 x = x0-r1; x <= x0+r1; x++) {
-            s32 distance = (x-x0) * (x-x0) + sqy;
-            float i1 = (r1_outer-distance+0.5f) / (2.0f*r1);
-            float i0 = (distance-r0_inner-0.5f) / (2.0f*r0);
-
-            u32 i0_ = blend_color_with_background(c, i0);
-            u32 i1_ = blend_color_with_background(c, i1);
-
-            bool inner_i0 = distance <= r0_inner;
-            bool outer_i0 = distance > r0_inner && distance < r0_outer;
-            bool inner_i1 = distance >= r0_outer && distance <= r1_inner;
-            bool outer_i1 = distance > r1_inner && distance < r1_outer;
-
-            if (inner_i0) {
-                continue;
-            }
-
-            if (outer_i0) {
-                set_pixel(buffer, x, y, i0_);
-                continue;
-            }
-
-            if (inner_i1) {
-                set_pixel(buffer, x, y, c);
-                continue;
-            }
-
-            if (outer_i1) {
-                set_pixel(buffer, x, y, i1_);
-                continue;
-            }
-        }
+//
+// However many configure events came since the last frame, only the last one is acked and reallocates the framebuffers.
+//
+static void apply_pending_configure(client_state_t* state) {
+    if (state->configure_pending) {
+        xdg_surface_ack_configure(state->xdg_surface, state->configure_serial);
+        state->configure_pending = false;
     }
-}
-
-static void draw_disk(buffer_t* buffer, float x, float y, float ri, float ro, u32 c, rectangle_t* bounding) {
 
-    transform_screen_into_world_disk(&x, &y, &ri, &ro);
-
-    s32 x0 = (s32) x;
-    s32 y0 = (s32) y;
-    s32 r0 = (s32) ri;
-    s32 r1 = (s32) ro;
-
-    if (bounding) {
-        *bounding = (rectangle_t) {
-            .x = x0 - r1,
-            .y = y0 - r1,
-            .w = r1 * 2,
-            .h = r1 * 2,
-        };
+    if (!state->resize_pending) {
+        return;
     }
+    state->resize_pending = false;
 
-    draw_disk_internal(buffer, x0, y0, r0, r1, c);
-}
-
-static void draw_text(buffer_t* buffer, float x, float y, const char* text, u32 color) {
-
-    static unsigned char ttf_buffer[1<<20];
-    static unsigned char temp_bitmap[512*512];
-    static stbtt_bakedchar cdata[96]; // ASCII 32..126 is 95 glyphs
-    static bool first_time = true;
-
-    uint32_t stride = sizeof(uint8_t) * 512;
-
-    if (first_time) {
+    framebuffer_set_interactive(&state->framebuffers, state->resizing);
 
-        // @Incomplete: abstract this away.
-
-        first_time = false;
-        fread(ttf_buffer, 1, 1<<20, fopen("/usr/share/fonts/rsms-inter-fonts/Inter-Regular.ttf", "rb"));
-        stbtt_BakeFontBitmap(ttf_buffer, 0, 32.0, temp_bitmap, 512, 512, 32, 96, cdata); // no guarantee this fits!
-
-        // stbi_write_png("example.png", 512, 128, 1, temp_bitmap, sizeof(uint8_t) * 512);
+    f32 scale = render_scale(state);
+    if (state->pending_width == state->width && state->pending_height == state->height && scale == state->buffer_scale) {
+        return;
     }
 
-    transform_world_into_screen(&x, &y);
-
-    while (*text) {
-        if (*text >= 32) { // @Incomplete: check that we can actually draw this symbol, if not, draw something default...
-
-            // @Incomplete: don't use baked quad, please. Although, we only need Engrish, so we might not need any actual packing algorithms.
-            stbtt_aligned_quad q;
-            stbtt_GetBakedQuad(cdata, 512, 512, *text-32, &x, &y, &q, 1); // 1 for opengl and 0 for d3d9, d3d10+
-
-            f32 x0 = q.x0;
-            f32 y0 = q.y0;
-            f32 x1 = q.x1;
-            f32 y1 = q.y1;
-
-            f32 u0 = q.s0;
-            f32 v0 = q.t0;
-            f32 u1 = q.s1;
-            f32 v1 = q.t1;
-
-            draw_textured_box_internal(buffer, temp_bitmap, x0, y0, x1, y1, u0, v0, u1, v1, color);
-        }
-        text += 1;
+    if (!reallocate_framebuffer(state, state->pending_width, state->pending_height, scale)) {
+        return; // @Note: the buffers are as they were, so is what's in them.
     }
+
+    add_command(&state->command_buffer, (command_t) {
+        .type = COMMAND_TYPE_DRAW_EVERYTHING,
+    });
 }
 
+//
+// Builds the queued frame once the compositor is ready for it and hands it to the render thread,
+// called by the main loop after every dispatch. present_frame commits it once it's drawn.
+//
 static void execute_command_buffer(client_state_t* state) {
-    check_buffer_is_not_used_by_the_compositor(state);
-
-    if (state->command_buffer.length == 0) {
-        // Nothing to do...
+    if (!state->configured || state->frame_in_flight || !frame_scheduler_ready(&state->scheduler)) {
+        // @Note: whatever arrives while a frame is being drawn stays queued and goes into the next one.
         return;
     }
 
-    wl_surface_attach(state->surface, state->buffer.buffer, 0, 0);
-
-    for (int i = 0; i < state->command_buffer.length; i++) {
-        command_t command = state->command_buffer.commands[i];
-
-        rectangle_t invalidate_region = {};
-
-        if (command.type == COMMAND_TYPE_DRAW_EVERYTHING) {
-
-            // brown editor: #3f3f3f
-            // brown highlight line editor: #4f4f4f
-            // black windows: #111111
-            // black highlight line windows: #1f1f1f
-            // yellow status bar: #774f00
-            //
-
-            // draw scene
-
-            { // background.
-                // @Note: this is terribly inefficient... z buffer? @Note: although, we are invalidating the entire framebuffer, so we need to redraw it fully too.
-                f32 x = 0.0f;
-                f32 y = 0.0f;
-                f32 w = 0.999f; // @Incomplete: handle 1.0f.
-                f32 h = 0.999f; // @Incomplete: handle 1.0f.
-
-                draw_box(&state->buffer, x, y, w, h, 0xff774f00, NULL);
-            }
-
-            { // editor window.
-                f32 x = 0.00f;
-                f32 y = 0.25f;
-                f32 w = 0.45f;
-                f32 h = 0.7f;
-
-                draw_box(&state->buffer, x, y, w, h, 0xff3f3f3f, NULL);
-            }
-
-            { // disassembly window.
-                f32 x = 0.0f;
-                f32 y = 0.0f;
-                f32 w = 0.45f;
-                f32 h = 0.24f;
-
-                draw_box(&state->buffer, x, y, w, h, 0xff3f3f3f, NULL);
-            }
-
-            { // watch window.
-                f32 x = 0.46f;
-                f32 y = 0.4f;
-                f32 w = 0.53f;
-                f32 h = 0.55f;
+    apply_pending_configure(state);
 
-                draw_box(&state->buffer, x, y, w, h, 0xff111111, NULL);
-            }
-
-            { // call stack window.
-                f32 x = 0.46f;
-                f32 y = 0.0f;
-                f32 w = 0.53f;
-                f32 h = 0.39f;
-
-                draw_box(&state->buffer, x, y, w, h, 0xff111111, NULL);
-            }
-
-            { // breakpoint on an editor window :)
-                f32 x = 0.01f;
-                f32 y = 0.4f;
-                f32 r = 0.01f;
-
-                draw_circle(&state->buffer, x, y, r, 0xffdb0f10, NULL);
-            }
-
-            f32 bar_x = 0.46f;
-            f32 bar_y = 0.918f;
-            { // watch window box
-                {
-                    f32 w = 0.075f;
-                    f32 h = 0.03f;
-
-                    draw_box(&state->buffer, bar_x, bar_y, w, h, 0xff22436b, NULL);
-                }
-
-                {
-                    float x = bar_x + 0.005f;
-                    float y = bar_y + 0.004f;
-                    const char* text = "Watch";
-                    draw_text(&state->buffer, x, y, text, 0xffffffff); // @Incomplete: query text size first and draw bounding box after it.
-                }
-            }
-
-            bar_x += 0.078f;
-
-            { // registers window box
-                {
-                    f32 w = 0.1f;
-                    f32 h = 0.03f;
-
-                    draw_box(&state->buffer, bar_x, bar_y, w, h, 0xff22436b, NULL);
-                }
-
-                {
-                    float x = bar_x + 0.005f;
-                    float y = bar_y + 0.004f;
-                    const char* text = "Registers";
-                    draw_text(&state->buffer, x, y, text, 0xffffffff); // @Incomplete: query text size first and draw bounding box after it.
-                }
-            }
-
-            bar_x = 0.46f;
-            bar_y = 0.358f;
-            { // call stack window box
-                {
-                    f32 w = 0.11f;
-                    f32 h = 0.03f;
-
-                    draw_box(&state->buffer, bar_x, bar_y, w, h, 0xff22436b, NULL);
-                }
-
-                {
-                    float x = bar_x + 0.005f;
-                    float y = bar_y + 0.004f;
-                    const char* text = "Call Stack";
-                    draw_text(&state->buffer, x, y, text, 0xffffffff); // @Incomplete: query text size first and draw bounding box after it.
-                }
-            }
-
-            bar_x += 0.115f;
-
-            { // call stack window box
-                {
-                    f32 w = 0.12f;
-                    f32 h = 0.03f;
-
-                    draw_box(&state->buffer, bar_x, bar_y, w, h, 0xff22436b, NULL);
-                }
-
-                {
-                    float x = bar_x + 0.005f;
-                    float y = bar_y + 0.004f;
-                    const char* text = "Breakpoints";
-                    draw_text(&state->buffer, x, y, text, 0xffffffff); // @Incomplete: query text size first and draw bounding box after it.
-                }
-            }
-
-
-            invalidate_region = (rectangle_t) {
-                .x = 0,
-                .y = 0,
-                .w = state->buffer.width,
-                .h = state->buffer.height,
-            };
-
-        } else if (command.type == COMMAND_TYPE_DRAW_BOX) {
-            draw_box(&state->buffer, command.box.x, command.box.y, command.box.w, command.box.h, command.box.color, &invalidate_region);
-
-        } else if (command.type == COMMAND_TYPE_DRAW_CIRCLE) {
-            draw_circle(&state->buffer, command.circle.x, command.circle.y, command.circle.r, command.circle.color, &invalidate_region);
-
-        } else if (command.type == COMMAND_TYPE_DRAW_DISK) {
-            draw_disk(&state->buffer, command.disk.x, command.disk.y, command.disk.r0, command.disk.r1, command.disk.color, &invalidate_region);
-
-        } else {
-            assert(0);
-        }
-
-        s32 x = invalidate_region.x;
-        s32 y = invalidate_region.y;
-        s32 w = invalidate_region.w;
-        s32 h = invalidate_region.h;
-
-        wl_surface_damage_buffer(state->surface, x, y, w, h);
+    if (state->command_buffer.length == 0 && !ui_is_dirty(&state->ui)) {
+        // Nothing to do...
+        frame_scheduler_cancel(&state->scheduler);
+        return;
     }
 
-    state->command_buffer.length = 0;
-    memset(state->command_buffer.commands, 0, sizeof(state->command_buffer.commands));
-
-    wl_surface_commit(state->surface);
-
-    state->used_by_compositor = state->buffer;
-    state->buffer             = empty;
-}
+    render_job_t job = { .frame = &state->frame };
+#ifdef HAS_PROFILER
+    job.profile_start = profiler_begin();
+#endif
 
-static void try_execute_command_buffer(client_state_t* state) {
-    if (buffer_is_ready_for_drawing(state)) {
-        execute_command_buffer(state);
+    PROFILE_BEGIN(acquire);
+    job.buffer = framebuffer_acquire(&state->framebuffers);
+    PROFILE_END(acquire, PROFILE_ALLOCATE);
+    if (job.buffer == NULL) {
+        // @Note: every buffer is held by the compositor, the frame stays queued until the next release.
+        return;
     }
-}
 
-static void add_command(command_buffer_t* buffer, command_t cmd) {
-    if (buffer->length >= MAX_RENDERING_COMMANDS) {
-        assert(0 && "Command buffer doesn't handle more than MAX_RENDERING_COMMANDS commands");
+    if (!framebuffer_has_previous(&state->framebuffers, job.buffer)) {
+        add_command(&state->command_buffer, (command_t) {
+            .type = COMMAND_TYPE_DRAW_EVERYTHING,
+        });
     }
 
-    buffer->commands[buffer->length++] = cmd;
-}
-
-static void buffer_release(void *data, struct wl_buffer *wl_buffer) {
-    client_state_t* state = data;
-
-    //
-    // @Note: We can only reuse the shared buffer when it's no longer used by the compositor.
-    //
-
-    if (state->used_by_compositor.buffer == wl_buffer) {
-        state->buffer = state->used_by_compositor;
-        state->used_by_compositor = empty;
-
-        execute_command_buffer(state);
+#ifdef HAS_PROFILER
+    if (state->show_profiler) {
+        // @Note: shows the previous frames, this one is only measured once it's committed.
+        profiler_add_overlay(&state->command_buffer);
     }
+#endif
 
-    if (state->request_destruction.buffer == wl_buffer) {
-        wl_buffer_destroy(wl_buffer);
+    build_frame(job.frame, job.buffer, &state->command_buffer, REGION_DEFAULT_RECT_BUDGET);
+    command_buffer_reset(&state->command_buffer);
 
-        int size = state->request_destruction.width * sizeof(uint32_t) * state->request_destruction.height;
+    job.copy_forward = !job.frame->everything;
 
-        munmap(state->request_destruction.data, size);
-        state->request_destruction = empty;
-    }
+    state->frame_in_flight = true;
+    frame_scheduler_begin(&state->scheduler);
+    render_thread_submit(&state->render_thread, job);
 }
 
-static const struct wl_buffer_listener buffer_listener = {
-    .release = buffer_release,
-};
-
-static int allocate_shared_file(size_t size) {
-    int fd = memfd_create("my-shell-shared", MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_NOEXEC_SEAL);
+//
+// The render thread is done with the frame, attach and commit it.
+//
+static void present_frame(client_state_t* state, render_job_t* job) {
+    frame_t*  frame  = job->frame;
+    buffer_t* buffer = job->buffer;
 
-    int ret;
-    do {
-        ret = ftruncate(fd, size);
-    } while (ret < 0 && errno == EINTR);
+    state->frame_in_flight = false;
 
-    if (ret < 0) {
-        close(fd);
-        return -1;
+    if (frame->stats.pending >= COMMAND_PRESSURE_WARNING) {
+        log_warning(LOG_RENDER, "Frame had %d pending commands: %d merged, %d drawn in %d batches.",
+                    frame->stats.pending, frame->stats.merged, frame->stats.drawn, frame->stats.batches);
     }
 
-    return fd;
-}
-
-static void reallocate_framebuffer(client_state_t* state, int width, int height) {
-
-    if (state->buffer.buffer) {
-        // Buffer is ours, can destruct inplace.
+    PROFILE_BEGIN(commit);
+    wl_surface_attach(state->surface, buffer->buffer, 0, 0);
 
-        int stride = state->buffer.width * sizeof(uint32_t);
-        int size = stride * state->buffer.height;
-
-        wl_buffer_destroy(state->buffer.buffer);
-        munmap(state->buffer.data, size);
-    } else {
-        assert(state->used_by_compositor.buffer);
-        state->request_destruction = state->used_by_compositor;
-        state->buffer = empty;
+    // @Note: one damage rect per coalesced rect, the compositor only uploads these.
+    for (int i = 0; i < frame->damage.count; i++) {
+        rectangle_t rect = frame->damage.rects[i];
+        wl_surface_damage_buffer(state->surface, rect.x, rect.y, rect.w, rect.h);
     }
 
-    state->width  = width;
-    state->height = height;
-
-    int stride = width * sizeof(uint32_t);
-    int size = stride * height;
-
-    int fd = allocate_shared_file(size);
-
-    uint32_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
-    auto buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
-    wl_shm_pool_destroy(pool);
-    close(fd);
-
-    state->buffer.buffer      = buffer;
-    state->used_by_compositor = empty;
+    frame_scheduler_commit(&state->scheduler, state->surface);
+    wl_surface_commit(state->surface);
+    PROFILE_END(commit, PROFILE_COMMIT);
 
-    wl_buffer_add_listener(buffer, &buffer_listener, state);
+    framebuffer_present(&state->framebuffers, buffer, &frame->damage);
 
-    state->buffer = (buffer_t) {
-        .buffer = buffer,
-        .data   = data,
-        .width  = width,
-        .height = height,
-    };
+#ifdef HAS_PROFILER
+    profiler_end(PROFILE_EXECUTE, job->profile_start);
+    profiler_end_frame(frame->stats.pixels, frame->stats.drawn);
+#endif
 }
 
-static buffer_t allocate_framebuffer(client_state_t *state) {
-    int width  = state->width;
-    int height = state->height;
-    int stride = width * sizeof(uint32_t);
-    int size = stride * height;
-
-    int fd = allocate_shared_file(size);
-
-    uint32_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
-    auto buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
-    state->used_by_compositor = empty;
-    wl_shm_pool_destroy(pool);
-    close(fd);
-
-    // munmap(data, size);
-    wl_buffer_add_listener(buffer, &buffer_listener, state);
-
-    buffer_t result = {
-        .buffer = buffer,
-        .data   = data,
-        .width  = width,
-        .height = height,
-    };
-    return result;
+//
+// Input and configure handlers only update the state and queue a frame, drawing happens at most once per compositor frame.
+//
+static void request_frame(client_state_t* state) {
+    frame_scheduler_request(&state->scheduler);
 }
 
 void output_geometry(void *data, struct wl_output *wl_output, int32_t x, int32_t y, int32_t physical_width, int32_t physical_height, int32_t subpixel, const char *make, const char *model, int32_t transform) {
@@ -956,12 +333,22 @@ void output_mode(void *data, struct wl_output *wl_output, uint32_t flags, int32_
 
     state->display_width  = width;
     state->display_height = height;
+
+    if (flags & WL_OUTPUT_MODE_CURRENT) {
+        frame_scheduler_set_refresh(&state->scheduler, refresh);
+    }
 }
 
 void output_done(void *data, struct wl_output *wl_output) {
 }
 
 void output_scale(void *data, struct wl_output *wl_output, int32_t factor) {
+    client_state_t* state = data;
+
+    // @Note: only a fallback, what the surface itself prefers knows which output it's on.
+    if (!state->has_fractional_scale && !state->has_preferred_buffer_scale) {
+        set_preferred_scale(state, (f32) factor);
+    }
 }
 
 void output_name(void *data, struct wl_output *wl_output, const char *name) {
@@ -988,6 +375,7 @@ void pointer_enter(void* data, struct wl_pointer* wl_pointer, uint32_t serial, s
     state->serial = serial;
 
     wp_cursor_shape_device_v1_set_shape(state->cursor_shape_device, serial, WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_DEFAULT);
+    state->cursor_shape = WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_DEFAULT;
 }
 
 void pointer_leave(void* data, struct wl_pointer* wl_pointer, uint32_t serial, struct wl_surface* surface) {
@@ -1102,7 +490,12 @@ void pointer_motion(void* data, struct wl_pointer* wl_pointer, uint32_t time, wl
 
         auto edge = find_interactive_edge(width, height, x, y);
         auto shape = edge_to_shape(edge);
-        wp_cursor_shape_device_v1_set_shape(state->cursor_shape_device, state->serial, shape);
+
+        // @Note: motion comes at the mouse's polling rate, only tell the compositor when the shape actually changes.
+        if (shape != state->cursor_shape) {
+            wp_cursor_shape_device_v1_set_shape(state->cursor_shape_device, state->serial, shape);
+            state->cursor_shape = shape;
+        }
     }
 
     state->cursor_x = wl_fixed_to_int(surface_x);
@@ -1112,55 +505,12 @@ void pointer_motion(void* data, struct wl_pointer* wl_pointer, uint32_t time, wl
         return;
     }
 
-    float rect_x = state->button.x;
-    float rect_y = state->button.y;
-    float rect_w = state->button.w;
-    float rect_h = state->button.h;
-
     double x = wl_fixed_to_double(surface_x);
     double y = wl_fixed_to_double(surface_y);
     transform_screen_into_world(&x, &y);
 
-    bool in_x = x > rect_x && x < rect_x + rect_w;
-    bool in_y = y > rect_y && y < rect_y + rect_h;
-    bool in_box = in_x && in_y;
-
-    // fprintf(stderr, "Pointer: %d, %d\n", x, y);
-    // fprintf(stderr, "Pointer: %f, %f\n", x, y);
-
-
-    if (in_box) {
-        if (state->button.hovered == false) {
-            state->button.hovered = true;
-
-            add_command(&state->command_buffer, (command_t) {
-                .type = COMMAND_TYPE_DRAW_BOX,
-                .box  = {
-                    .x = rect_x,
-                    .y = rect_y,
-                    .w = rect_w,
-                    .h = rect_h,
-                    .color  = make_u32_from_color((color_t){ .r = 0.0f, .g = 1.0f, .b = 0.0f, .a = 1.0f }),
-                },
-            });
-        }
-
-    } else {
-        if (state->button.hovered == true) {
-            state->button.hovered = false;
-
-            add_command(&state->command_buffer, (command_t) {
-                .type  = COMMAND_TYPE_DRAW_BOX,
-                .box   = {
-                    .x = rect_x,
-                    .y = rect_y,
-                    .w = rect_w,
-                    .h = rect_h,
-                    .color = make_u32_from_color((color_t){ .r = 1.0f, .g = 0.0f, .b = 0.0f, .a = 1.0f }),
-                },
-            });
-        }
-    }
+    // @Note: hovered tabs only mark themselves dirty, the next frame redraws just them.
+    ui_update_hover(&state->ui, (f32) x, (f32) y);
 
 #if 0
     add_command(&state->command_buffer, (command_t) {
@@ -1172,7 +522,7 @@ void pointer_motion(void* data, struct wl_pointer* wl_pointer, uint32_t time, wl
             .color  = make_u32_from_color((color_t){ .r = 0.0f, .g = 0.0f, .b = 1.0f, .a = 1.0f }),
         },
     });
-    try_execute_command_buffer(data);
+    request_frame(state);
 
     add_command(&state->command_buffer, (command_t) {
         .type = COMMAND_TYPE_DRAW_DISK,
@@ -1185,7 +535,7 @@ void pointer_motion(void* data, struct wl_pointer* wl_pointer, uint32_t time, wl
         },
     });
 #endif
-    try_execute_command_buffer(data);
+    request_frame(state);
 }
 
 void pointer_button(void* data, struct wl_pointer* wl_pointer, uint32_t serial, uint32_t time, uint32_t button, uint32_t state) {
@@ -1315,8 +665,25 @@ static void surface_leave(void* data, struct wl_surface* surface, struct wl_outp
 }
 
 static void surface_preferred_buffer_scale(void* data, struct wl_surface* wl_surface, int32_t factor) {
+    client_state_t* state = data;
+
+    state->has_preferred_buffer_scale = true;
+    if (!state->has_fractional_scale) {
+        set_preferred_scale(state, (f32) factor);
+    }
 }
 
+static void fractional_scale_preferred_scale(void* data, struct wp_fractional_scale_v1* fractional_scale, uint32_t scale) {
+    client_state_t* state = data;
+
+    state->has_fractional_scale = true;
+    set_preferred_scale(state, (f32) scale / FRACTIONAL_SCALE_DENOMINATOR);
+}
+
+static const struct wp_fractional_scale_v1_listener fractional_scale_listener = {
+    .preferred_scale = fractional_scale_preferred_scale,
+};
+
 static void surface_preferred_buffer_transform(void* data, struct wl_surface* wl_surface, uint32_t transform) {
 }
 
@@ -1359,7 +726,7 @@ void registry_global(void* data, struct wl_registry* wl_registry, uint32_t name,
         xdg_wm_base_add_listener(state->xdg_wm_base, &xdg_wm_base_listener, data);
 
     } else if (strcmp(interface, wl_output_interface.name) == 0) {
-        state->output = wl_registry_bind(wl_registry, name, &wl_output_interface, 1);
+        state->output = wl_registry_bind(wl_registry, name, &wl_output_interface, min(version, 2)); // `2` for the scale.
         wl_output_add_listener(state->output, &output_listener, data);
 
     } else if (strcmp(interface, wp_cursor_shape_manager_v1_interface.name) == 0) {
@@ -1367,6 +734,12 @@ void registry_global(void* data, struct wl_registry* wl_registry, uint32_t name,
 
     } else if (strcmp(interface, zxdg_decoration_manager_v1_interface.name) == 0) {
         state->xdg_decoration_manager = wl_registry_bind(wl_registry, name, &zxdg_decoration_manager_v1_interface, 1);
+
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        state->viewporter = wl_registry_bind(wl_registry, name, &wp_viewporter_interface, 1);
+
+    } else if (strcmp(interface, wp_fractional_scale_manager_v1_interface.name) == 0) {
+        state->fractional_scale_manager = wl_registry_bind(wl_registry, name, &wp_fractional_scale_manager_v1_interface, 1);
     }
 }
 
@@ -1380,7 +753,10 @@ static const struct wl_registry_listener registry_listener = {
 void xdg_surface_configure(void* data, struct xdg_surface* xdg_surface, uint32_t serial) {
     client_state_t* state = data;
 
-    xdg_surface_ack_configure(xdg_surface, serial);
+    state->configured        = true;
+    state->configure_pending = true;
+    state->configure_serial  = serial;
+    request_frame(state);
 #if 0
     if (state->request_resize) {
         state->ready_to_resize = true;
@@ -1395,17 +771,21 @@ static struct xdg_surface_listener xdg_surface_listener = {
 void xdg_toplevel_configure(void *data, struct xdg_toplevel *xdg_toplevel, int32_t width, int32_t height, struct wl_array *states) {
     client_state_t* state = data;
 
-    if (width != 0 && height != 0) {
-        update_orthographic_projection(width, height);
-
+    bool resizing = false;
 
-        // @Incomplete: @SluggishResize: cap resizing at 60fps, some gaming mice can send thounsands of requests per second and that is going to kill the performance here.
-        reallocate_framebuffer(state, width, height);
+    uint32_t* it;
+    wl_array_for_each(it, states) {
+        if (*it == XDG_TOPLEVEL_STATE_RESIZING) resizing = true;
+    }
 
-        add_command(&state->command_buffer, (command_t) {
-            .type = COMMAND_TYPE_DRAW_EVERYTHING,
-        });
-        try_execute_command_buffer(state);
+    // @Note: @SluggishResize: some gaming mice send thousands of these per second while dragging,
+    // they are coalesced into one reallocation and one repaint per frame by apply_pending_configure.
+    if (width != 0 && height != 0) {
+        state->resize_pending = true;
+        state->resizing       = resizing;
+        state->pending_width  = width;
+        state->pending_height = height;
+        request_frame(state);
     }
 }
 
@@ -1477,22 +857,19 @@ static void libdecor_event_configure(struct libdecor_frame* frame, struct libdec
 
     // fprintf(stderr, "Libdecor (%d, %d)\n", width, height);
 
-	client->width = width;
-	client->height = height;
-
     libdecor_frame_set_max_content_size(frame, width, height);
 
 	struct libdecor_state* state = libdecor_state_new(width, height);
 	libdecor_frame_commit(frame, state, configuration);
 	libdecor_state_free(state);
 
+    // @Note: libdecor acks the configuration itself, we only coalesce the resize.
+    client->configured = true;
     if (width != 0 && height != 0) {
-        reallocate_framebuffer(client, width, height);
-
-        add_command(&state->command_buffer, (command_t) {
-            .type = COMMAND_TYPE_DRAW_EVERYTHING,
-        });
-        try_execute_command_buffer(client);
+        client->resize_pending = true;
+        client->pending_width  = width;
+        client->pending_height = height;
+        request_frame(client);
     }
 }
 
@@ -1544,24 +921,63 @@ void init_libdecor_window(struct wl_display* display, client_state_t* state) {
 }
 
 void init_scene(client_state_t* state) {
-    state->button = (button_t) {
-        .x = 0.0f,
-        .y = 0.0f,
-        .w = 0.2f,
-        .h = 0.2f,
-    };
+    ui_init(&state->ui);
+    build_layout(&state->ui);
 }
 
-int main() {
+int main(int argc, char** argv) {
 
     client_state_t state = {};
+    const char* log_path = NULL; // stdout.
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--low-power") == 0) {
+            state.low_power = true; // @Note: renders at REDUCED_SCALE_PERCENT of the output's scale and lets the compositor upscale.
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            log_path = argv[++i];
+#ifdef HAS_PROFILER
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profiler_set_enabled(true);
+        } else if (strcmp(argv[i], "--profile-overlay") == 0) {
+            profiler_set_enabled(true);
+            state.show_profiler = true;
+#endif
+        } else {
+#ifdef HAS_PROFILER
+            print("usage: %s [--low-power] [--log FILE] [--profile] [--profile-overlay]", argv[0]);
+#else
+            print("usage: %s [--low-power] [--log FILE]", argv[0]);
+#endif
+            return 1;
+        }
+    }
+
+    if (!log_init(log_path)) {
+        return 1;
+    }
     init_scene(&state);
+    frame_scheduler_init(&state.scheduler);
+    tile_renderer_init(&state.tile_renderer, 0);
+
+    arena_init(&state.command_arena, PENDING_COMMANDS_ARENA_SIZE);
+    command_buffer_init(&state.command_buffer, &state.command_arena);
+    frame_init(&state.frame, FRAME_ARENA_SIZE, &state.ui);
 
     auto display  = wl_display_connect(NULL);  // wl_display_add_listener(display, &display_listener, &state);
     auto registry = wl_display_get_registry(display);
     wl_registry_add_listener(registry, &registry_listener, &state);
     wl_display_roundtrip(display);
 
+    // @Note: fractional scales can only be shown through a viewport.
+    if (state.viewporter) {
+        state.viewport = wp_viewporter_get_viewport(state.viewporter, state.surface);
+
+        if (state.fractional_scale_manager) {
+            state.fractional_scale = wp_fractional_scale_manager_v1_get_fractional_scale(state.fractional_scale_manager, state.surface);
+            wp_fractional_scale_v1_add_listener(state.fractional_scale, &fractional_scale_listener, &state);
+        }
+    }
+
     if (state.xdg_decoration_manager) {
         init_wayland_window(display, &state);
     } else {
@@ -1579,44 +995,119 @@ int main() {
     state.width  = initial_width;
     state.height = initial_height;
 
-    update_orthographic_projection(initial_width, initial_height);
+    // @Note: starts at scale 1, the first frame picks up whatever the compositor told us about the scale by then.
+    state.preferred_scale = 1.0f;
+    state.buffer_scale    = 1.0f;
+    state.pending_width   = initial_width;
+    state.pending_height  = initial_height;
+    state.resize_pending  = true;
+
+    update_orthographic_projection(initial_width, initial_height, state.buffer_scale);
 
     wl_surface_commit(state.surface);
 
 
-    state.buffer = allocate_framebuffer(&state);
+    if (!framebuffer_init(&state.framebuffers, state.shm, FRAMEBUFFER_DEFAULT_BUFFERS, state.width, state.height)) {
+        log_shutdown();
+        return 1;
+    }
+
+    if (!render_thread_init(&state.render_thread, &state.tile_renderer, &state.framebuffers)) {
+        framebuffer_destroy(&state.framebuffers);
+        log_shutdown();
+        return 1;
+    }
+
     add_command(&state.command_buffer, (command_t) {
         .type = COMMAND_TYPE_DRAW_EVERYTHING,
     });
-    try_execute_command_buffer(&state);
+    request_frame(&state);
 
 
-    int fd = wl_display_get_fd(display);
+    int fd      = wl_display_get_fd(display);
+    int done_fd = state.render_thread.done_fd;
     while (true) {
+        // @Note: nothing allocated in temporary storage lives longer than one iteration.
+        temporary_reset();
+
         fd_set set;
         FD_ZERO(&set);
         FD_SET(fd, &set);
+        FD_SET(done_fd, &set);
 
         while (wl_display_prepare_read(display) != 0) {
+            PROFILE_BEGIN(dispatch);
             wl_display_dispatch_pending(display);
+            PROFILE_END(dispatch, PROFILE_DISPATCH);
         }
 
         if (state.request_quit) {
             break;
         }
 
+        // @Note: everything that arrived since the last frame is dispatched by now, so this draws the latest state.
+        // Buffer releases and frame callbacks come through the display too and land here.
+        execute_command_buffer(&state);
+
         wl_display_flush(display);
-        select(fd+1, &set, NULL, NULL, NULL);
+        select(max(fd, done_fd)+1, &set, NULL, NULL, NULL);
 
         if (FD_ISSET(fd, &set)) {
             wl_display_read_events(display);
         } else {
             wl_display_cancel_read(display);
         }
+
+        // @Note: the commit is flushed with the next wl_display_flush, right after dispatching what we just read.
+        if (FD_ISSET(done_fd, &set)) {
+            render_job_t job;
+            while (render_thread_take_done(&state.render_thread, &job)) {
+                present_frame(&state, &job);
+            }
+        }
     }
 
     // TODO: this just doesn't work, use goto to jump here.
+
+    // @Note: waits for the frame in flight, if there is one. Everything below reads what the render thread wrote.
+    render_thread_destroy(&state.render_thread);
+
+    frame_scheduler_stats_t* stats = &state.scheduler.stats;
+    log_info(LOG_GENERAL, "Rendered %llu frames for %llu requests, %llu coalesced, %llu missed deadlines.",
+             stats->frames, stats->requests, stats->coalesced, stats->missed);
+
+    framebuffer_stats_t* buffers = &state.framebuffers.stats;
+    log_info(LOG_GENERAL, "Resized %llu times, %llu in place, the pool grew %llu times.", buffers->resizes, buffers->resizes_in_place, buffers->pool_grows);
+    log_info(LOG_GENERAL, "Copied %llu pixels forward in %llu frames.", buffers->copied_pixels, buffers->copies);
+
+    render_thread_stats_t* render = &state.render_thread.stats;
+    log_info(LOG_GENERAL, "Render thread drew %llu frames, woken up %llu times.", render->frames, render->wakeups);
+
+    temporary_stats_t temporary = temporary_stats();
+    log_info(LOG_GENERAL, "Temporary storage peaked at %llu bytes in a frame, %llu overflow blocks.", temporary.peak, temporary.overflows);
+
+#ifdef HAS_PROFILER
+    if (profiler.enabled) {
+        profile_summary_t summary = profiler_summary();
+        log_info(LOG_GENERAL, "Last %d frames took %.2f ms at p50, %.2f ms at p99 and %.2f ms at most.",
+                 summary.frames, (f64) summary.p50_ns / 1e6, (f64) summary.p99_ns / 1e6, (f64) summary.max_ns / 1e6);
+    }
+#endif
+
+    if (state.fractional_scale) wp_fractional_scale_v1_destroy(state.fractional_scale);
+    if (state.viewport)         wp_viewport_destroy(state.viewport);
+
+    frame_scheduler_destroy(&state.scheduler);
+    framebuffer_destroy(&state.framebuffers);
     wl_display_disconnect(display);
+    tile_renderer_destroy(&state.tile_renderer);
+    frame_free(&state.frame);
+    arena_free(&state.command_arena);
+
+    log_shutdown();
+
+    log_stats_t logged = log_stats();
+    print("Logged %llu records in %llu writes, %llu dropped, %llu truncated.", logged.records, logged.writes, logged.dropped, logged.truncated);
     return 0;
 }
 
@@ -1,51 +1,141 @@
 #include "memory_arena.h"
 #include "types.h"
+#include "base.h"
+#include "log.h"
 
-#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
 
-#if 0
-typedef struct memory_arena_t {
-    uint8* data;
-    uint32 capacity;
-    uint32 mark;
-} memory_arena_t;
 
-void arena_init(memory_arena_t* arena, u32 size);
+static u64 round_up_to_granularity(u64 size) {
+    return (size + ARENA_COMMIT_GRANULARITY - 1) / ARENA_COMMIT_GRANULARITY * ARENA_COMMIT_GRANULARITY;
+}
+
+// Makes sure the first size bytes are committed.
+static bool commit(memory_arena_t* arena, u64 size) {
+    if (size <= arena->committed) {
+        return true;
+    }
+    if (size > arena->reserved) {
+        return false;
+    }
+
+    u64 target = min(round_up_to_granularity(size), arena->reserved);
+    if (mprotect(arena->data + arena->committed, target - arena->committed, PROT_READ | PROT_WRITE) != 0) {
+        log_error(LOG_MEMORY, "Memory arena failed to commit %llu bytes, errno %d.", target - arena->committed, errno);
+        return false;
+    }
+
+    arena->committed = target;
+    return true;
+}
+
+// Gives back everything committed past size.
+static void decommit(memory_arena_t* arena, u64 size) {
+    size = round_up_to_granularity(size);
+    if (size >= arena->committed) {
+        return;
+    }
 
-void* arena_alloc(memory_arena_t* arena, u32 size, u32 alignment);
-void arena_reset(memory_arena_t* arena);
-#endif
+    // @Note: MADV_DONTNEED drops the pages, PROT_NONE makes touching them fault again instead of bringing them back zeroed.
+    u8* start  = arena->data + size;
+    u64 length = arena->committed - size;
+    madvise(start, length, MADV_DONTNEED);
+    mprotect(start, length, PROT_NONE);
 
+    arena->committed = size;
+}
+
+void arena_init(memory_arena_t* arena, u64 size) {
+    *arena = (memory_arena_t) {};
 
+    u64 reserved = max(round_up_to_granularity(size), (u64) ARENA_RESERVE);
 
-void arena_init(memory_arena_t* arena, u32 size) {
+    void* data = mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) {
+        // @Note: every allocation fails then, arena_alloc asserts and arena_try_alloc returns NULL.
+        log_error(LOG_MEMORY, "Memory arena failed to reserve %llu bytes, errno %d.", reserved, errno);
+        return;
+    }
 
-    *arena = (memory_arena_t) {
-        .data     = malloc(size),
-        .capacity = size,
-        .mark     = 0,
-    };
+    arena->data     = data;
+    arena->reserved = reserved;
+
+    commit(arena, size);
+    arena->retained = arena->committed;
 }
 
 void arena_free(memory_arena_t* arena) {
-    free(arena->data);
+    if (arena->data) {
+        munmap(arena->data, arena->reserved);
+    }
     *arena = (memory_arena_t) {};
 }
 
-void* arena_alloc(memory_arena_t* arena, u32 size, alignment_info_t alignment) {
+void* arena_try_alloc_uninitialized(memory_arena_t* arena, u64 size, alignment_info_t alignment) {
+    if (arena->data == NULL) {
+        return NULL;
+    }
+
+    uintptr_t base = (uintptr_t) arena->data;
+    u64 offset     = align(base + arena->mark, alignment) - base;
+
+    if (offset > arena->reserved || size > arena->reserved - offset || !commit(arena, offset + size)) {
+        return NULL;
+    }
+
+    arena->mark = offset + size;
+    arena->peak = max(arena->peak, arena->mark);
+
+    return arena->data + offset;
+}
+
+void* arena_try_alloc(memory_arena_t* arena, u64 size, alignment_info_t alignment) {
+    void* result = arena_try_alloc_uninitialized(arena, size, alignment);
+    if (result) {
+        memset(result, 0, size);
+    }
+    return result;
+}
+
+void* arena_alloc_uninitialized(memory_arena_t* arena, u64 size, alignment_info_t alignment) {
+    void* result = arena_try_alloc_uninitialized(arena, size, alignment);
+    assert(result && "Memory arena is out of space");
+    return result;
+}
+
+void* arena_alloc(memory_arena_t* arena, u64 size, alignment_info_t alignment) {
+    void* result = arena_try_alloc(arena, size, alignment);
+    assert(result && "Memory arena is out of space");
+    return result;
+}
 
-    auto ptr     = arena->data + arena->mark;
-    auto aligned = (uint8*) align((uintptr_t) ptr, alignment);
-    memset(aligned, 0, size);
+bool arena_extend(memory_arena_t* arena, void* block, u64 size, u64 new_size) {
+    if ((u8*) block + size != arena->data + arena->mark) {
+        return false;
+    }
 
-    // @Incomplete: check if we fit, otherwise allocate with malloc??? Log error?
-    arena->mark += (aligned - ptr) + size;
+    if (new_size < size) {
+        arena->mark -= size - new_size;
+        return true;
+    }
 
-    return aligned;
+    u64 growth = new_size - size;
+    if (growth > arena->reserved - arena->mark || !commit(arena, arena->mark + growth)) {
+        return false;
+    }
+
+    arena->mark += growth;
+    arena->peak  = max(arena->peak, arena->mark);
+    return true;
 }
 
 void arena_reset(memory_arena_t* arena) {
+    // @Note: keeps what the last cycle used, a spike is given back by the first reset after a cycle that doesn't repeat it.
+    decommit(arena, max(arena->retained, arena->peak));
+
     arena->mark = 0;
+    arena->peak = 0;
 }
-
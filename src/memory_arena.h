@@ -3,14 +3,54 @@
 #include "types.h"
 #include "align.h"
 
+//
+// Bump allocator over one big range of reserved address space.
+//
+// arena_init reserves ARENA_RESERVE bytes with PROT_NONE, which costs no memory, and pages are committed
+// (made readable and writable) in ARENA_COMMIT_GRANULARITY steps as the mark moves past them. So an arena grows in place
+// and never copies, and nothing outside of what was handed out is accessible: running off the end faults instead of
+// scribbling over something else.
+//
+// arena_reset gives the pages back that neither the last cycle nor the size passed to arena_init needed.
+// So a single big frame doesn't keep its memory around forever, and steady state use doesn't commit and decommit every cycle.
+//
+// @Note: arena_alloc zeroes, use the _uninitialized variants for memory that is written before it's read.
+//
+
+enum {
+    ARENA_RESERVE            = 1 << 30, // @Note: per arena, it's only address space.
+    ARENA_COMMIT_GRANULARITY = 64 * 1024,
+};
+
 typedef struct memory_arena_t {
-    uint8* data;
-    uint32 capacity;
-    uint32 mark;
+    uint8* data;     // start of the reservation, NULL when the arena isn't initialized.
+    u64 reserved;
+    u64 committed;   // bytes from data that are readable and writable.
+    u64 retained;    // committed bytes that are never given back, the size passed to arena_init.
+    u64 mark;
+    u64 peak;        // highest mark since the last reset.
 } memory_arena_t;
 
-void arena_init(memory_arena_t* arena, u32 size);
+//
+// @Note: size is committed right away and kept committed, it's what the arena is expected to need.
+//
+void arena_init(memory_arena_t* arena, u64 size);
+void arena_free(memory_arena_t* arena);
 
-void* arena_alloc(memory_arena_t* arena, u32 size, alignment_info_t alignment);
-void arena_reset(memory_arena_t* arena);
+void* arena_alloc(memory_arena_t* arena, u64 size, alignment_info_t alignment);
+void* arena_alloc_uninitialized(memory_arena_t* arena, u64 size, alignment_info_t alignment);
 
+// NULL when the reservation is exhausted or the pages can't be committed.
+void* arena_try_alloc(memory_arena_t* arena, u64 size, alignment_info_t alignment);
+void* arena_try_alloc_uninitialized(memory_arena_t* arena, u64 size, alignment_info_t alignment);
+
+#define arena_push_array(arena, type, count)               ((type*) arena_alloc((arena), (u64) (count) * sizeof(type), alignment_of(type)))
+#define arena_push_array_uninitialized(arena, type, count) ((type*) arena_alloc_uninitialized((arena), (u64) (count) * sizeof(type), alignment_of(type)))
+#define arena_push_struct(arena, type)                     arena_push_array((arena), type, 1)
+
+//
+// Grows or shrinks the last allocation in place, false if block isn't the last allocation or there is no room for it.
+// @Note: the new part is not zeroed.
+//
+bool arena_extend(memory_arena_t* arena, void* block, u64 size, u64 new_size);
+void arena_reset(memory_arena_t* arena);
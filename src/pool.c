@@ -0,0 +1,141 @@
+#include "pool.h"
+#include "base.h"
+
+#include <assert.h>
+#include <string.h>
+
+
+static pool_slot_t* get_slots(const pool_t* pool) {
+    return (pool_slot_t*) pool->slots.data;
+}
+
+static u32* get_owners(const pool_t* pool) {
+    return (u32*) pool->owners.data;
+}
+
+static u8* get_item(const pool_t* pool, u32 index) {
+    return pool->items.data + (u64) index * pool->item_size;
+}
+
+// The slot of a live object, NULL when the handle is stale or was never handed out.
+static pool_slot_t* find_slot(pool_t* pool, pool_handle_t handle) {
+    if (handle.index >= pool->slot_count) {
+        return NULL;
+    }
+
+    pool_slot_t* slot = &get_slots(pool)[handle.index];
+    if (slot->generation != handle.generation || (slot->generation & 1) == 0) {
+        pool->stats.stale += 1;
+        return NULL;
+    }
+    return slot;
+}
+
+void pool_init(pool_t* pool, u32 item_size, alignment_info_t alignment) {
+    assert(item_size > 0 && item_size % alignment.alignment == 0);
+
+    *pool = (pool_t) {
+        .item_size = item_size,
+        .alignment = alignment,
+        .free_slot = POOL_NONE,
+    };
+
+    // @Note: nothing is committed up front, pools that stay empty cost only address space.
+    arena_init(&pool->items,  0);
+    arena_init(&pool->owners, 0);
+    arena_init(&pool->slots,  0);
+}
+
+void pool_destroy(pool_t* pool) {
+    arena_free(&pool->items);
+    arena_free(&pool->owners);
+    arena_free(&pool->slots);
+    *pool = (pool_t) {};
+}
+
+void* pool_alloc(pool_t* pool, pool_handle_t* handle) {
+    if (pool->count == pool->capacity) {
+        // @Note: the arenas only hold these arrays, so every allocation lands right after the previous one.
+        arena_alloc_uninitialized(&pool->items, pool->item_size, pool->alignment);
+        arena_push_array_uninitialized(&pool->owners, u32, 1);
+        pool->capacity += 1;
+    }
+
+    u32 index = pool->free_slot;
+    if (index == POOL_NONE) {
+        pool_slot_t* slot = arena_push_struct(&pool->slots, pool_slot_t);
+        assert(slot == &get_slots(pool)[pool->slot_count]);
+
+        index = pool->slot_count;
+        pool->slot_count += 1;
+    } else {
+        pool->free_slot = get_slots(pool)[index].next;
+    }
+
+    pool_slot_t* slot = &get_slots(pool)[index];
+    slot->generation += 1;
+    slot->next        = pool->count;
+
+    get_owners(pool)[pool->count] = index;
+
+    u8* item = get_item(pool, pool->count);
+    memset(item, 0, pool->item_size);
+
+    pool->count += 1;
+    pool->stats.allocations += 1;
+
+    *handle = (pool_handle_t) { .index = index, .generation = slot->generation };
+    return item;
+}
+
+bool pool_release(pool_t* pool, pool_handle_t handle) {
+    pool_slot_t* slot = find_slot(pool, handle);
+    if (slot == NULL) {
+        return false;
+    }
+
+    u32 hole = slot->next;
+    u32 last = pool->count - 1;
+    if (hole != last) {
+        u32* owners = get_owners(pool);
+
+        memcpy(get_item(pool, hole), get_item(pool, last), pool->item_size);
+        owners[hole] = owners[last];
+        get_slots(pool)[owners[hole]].next = hole;
+    }
+
+    slot->generation += 1;
+    slot->next        = pool->free_slot;
+    pool->free_slot   = handle.index;
+
+    pool->count -= 1;
+    pool->stats.releases += 1;
+    return true;
+}
+
+void* pool_get(pool_t* pool, pool_handle_t handle) {
+    pool_slot_t* slot = find_slot(pool, handle);
+    return slot ? get_item(pool, slot->next) : NULL;
+}
+
+pool_handle_t pool_handle_at(const pool_t* pool, u32 i) {
+    assert(i < pool->count);
+
+    u32 index = get_owners(pool)[i];
+    return (pool_handle_t) { .index = index, .generation = get_slots(pool)[index].generation };
+}
+
+void pool_clear(pool_t* pool) {
+    pool_slot_t* slots  = get_slots(pool);
+    u32*         owners = get_owners(pool);
+
+    for (u32 i = 0; i < pool->count; i++) {
+        pool_slot_t* slot = &slots[owners[i]];
+        slot->generation += 1;
+        slot->next        = pool->free_slot;
+        pool->free_slot   = owners[i];
+    }
+
+    pool->stats.releases += pool->count;
+    pool->count = 0;
+}
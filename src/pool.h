@@ -0,0 +1,92 @@
+#pragma once
+
+#include "types.h"
+#include "align.h"
+#include "memory_arena.h"
+
+//
+// Fixed size objects that are allocated and released one by one, for long lived things that come and go
+// (breakpoints, watches, stack frames, widgets) and would otherwise fragment malloc.
+//
+// Live objects are packed at the start of one array, so update passes walk contiguous memory: pool_items[0 .. count).
+// Releasing an object moves the last one into its place. So pointers into the pool only stay valid until the next
+// release, handles stay valid until the object itself is released.
+//
+// A handle is a slot index and the generation of the slot. The slot points at where the object is in the array,
+// releasing bumps the generation, so a stale handle is caught by one compare. Free slots form an intrusive list
+// through the same field that points at the object of a live slot.
+//
+// Every array lives in its own memory_arena_t, so they grow in place and never copy.
+//
+// @Note: the zero handle is never valid, zero initialized handles mean "no object".
+//
+
+typedef struct {
+    u32 index;
+    u32 generation;
+} pool_handle_t;
+
+typedef struct {
+    u32 generation; // odd while the slot is live.
+    u32 next;       // live: where the object is in the items. Free: next free slot, POOL_NONE at the end of the list.
+} pool_slot_t;
+
+enum {
+    POOL_NONE = 0xffffffff,
+};
+
+typedef struct {
+    u64 allocations;
+    u64 releases;
+    u64 stale;       // lookups and releases with a handle whose object was already released.
+} pool_stats_t;
+
+typedef struct {
+    memory_arena_t items;  // live objects, packed.
+    memory_arena_t owners; // slot of every object, to fix up its slot when it moves.
+    memory_arena_t slots;
+
+    u32 item_size;
+    alignment_info_t alignment;
+
+    u32 count;      // live objects.
+    u32 capacity;   // objects the items can hold without growing.
+    u32 slot_count;
+    u32 free_slot;  // head of the free list.
+
+    pool_stats_t stats;
+} pool_t;
+
+void pool_init(pool_t* pool, u32 item_size, alignment_info_t alignment);
+void pool_destroy(pool_t* pool);
+
+//
+// Zero initialized object, its handle goes into handle.
+//
+void* pool_alloc(pool_t* pool, pool_handle_t* handle);
+
+//
+// false when the handle is stale, nothing happens then.
+// @Note: moves the last object into the place of the released one, walk backwards to release while iterating.
+//
+bool pool_release(pool_t* pool, pool_handle_t handle);
+
+//
+// NULL when the handle is stale.
+//
+void* pool_get(pool_t* pool, pool_handle_t handle);
+
+//
+// Handle of the i-th live object, for the objects found while iterating.
+//
+pool_handle_t pool_handle_at(const pool_t* pool, u32 i);
+
+//
+// Releases everything, every handle handed out so far becomes stale.
+//
+void pool_clear(pool_t* pool);
+
+#define pool_init_typed(pool, type)            pool_init((pool), sizeof(type), alignment_of(type))
+#define pool_alloc_typed(pool, type, handle)   ((type*) pool_alloc((pool), (handle)))
+#define pool_get_typed(pool, type, handle)     ((type*) pool_get((pool), (handle)))
+#define pool_items_typed(pool, type)           ((type*) (pool)->items.data)
@@ -1,99 +1,170 @@
 
 #include "print.h"
 #include "temporary_storage.h"
+#include "memory_arena.h"
+#include "base.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define STB_SPRINTF_IMPLEMENTATION
 #include "stb_sprintf.h"
 
 
-literal sprint(char const *fmt, ...)
-{
-    int out;
-    {
-        va_list va;
-        va_start(va, fmt);
+static_assert(STRING_BUILDER_CHUNK >= STB_SPRINTF_MIN + 1);
 
-        out = stbsp_vsnprintf(NULL, 0, fmt, va);
-        va_end(va);
+void string_builder_init(string_builder_t* builder, string_storage_t storage, struct memory_arena_t* arena) {
+    *builder = (string_builder_t) { .storage = storage, .arena = arena };
+}
+
+static char* grow_storage(string_builder_t* builder, u32 capacity) {
+    switch (builder->storage) {
+        case STRING_STORAGE_TEMPORARY: {
+            if (builder->data && temporary_extend(builder->data, builder->capacity, capacity)) {
+                return builder->data;
+            }
+            return temporary_alloc_uninitialized(capacity, align1);
+        }
+
+        case STRING_STORAGE_ARENA: {
+            if (builder->data && arena_extend(builder->arena, builder->data, builder->capacity, capacity)) {
+                return builder->data;
+            }
+            return arena_try_alloc_uninitialized(builder->arena, capacity, align1);
+        }
+
+        case STRING_STORAGE_HEAP: {
+            // @Note: realloc copies by itself.
+            char* data = realloc(builder->data, capacity);
+            if (data) {
+                builder->data = data;
+            }
+            return data;
+        }
     }
 
-    literal result = {
-        .data  = (const char*) malloc(out + 1),
-        .count = out,
-    };
+    return NULL;
+}
 
-    {
-        va_list va;
-        va_start(va, fmt);
+// Makes room for at least room more bytes after the string.
+static bool reserve(string_builder_t* builder, u32 room) {
+    if (builder->truncated) {
+        return false;
+    }
+    if (builder->capacity - builder->length >= room) {
+        return true;
+    }
 
-        out = stbsp_vsnprintf((char*) result.data, out + 1, fmt, va);
-        va_end(va);
+    u64 needed   = max((u64) builder->capacity * 2, (u64) builder->length + room);
+    u64 capacity = (needed + STRING_BUILDER_CHUNK - 1) / STRING_BUILDER_CHUNK * STRING_BUILDER_CHUNK;
 
-        assert((int) result.count == out);
+    char* data = capacity <= UINT32_MAX ? grow_storage(builder, (u32) capacity) : NULL;
+    if (data == NULL) {
+        builder->truncated = true;
+        return false;
     }
 
-    return result;
+    if (data != builder->data && builder->length > 0) {
+        memcpy(data, builder->data, builder->length);
+    }
+    builder->data     = data;
+    builder->capacity = (u32) capacity;
+    return true;
 }
 
-literal tprint(char const *fmt, ...)
-{
-    int out;
-
-    {
-        va_list va;
-        va_start(va, fmt);
+// stb_sprintf already wrote len characters at buf, which is the end of the string. Returns where the next ones go.
+static char* builder_callback(const char* buf, void* user, int len) {
+    string_builder_t* builder = user;
+    builder->length += (u32) len;
 
-        out = stbsp_vsnprintf(NULL, 0, fmt, va);
-        va_end(va);
+    if (!reserve(builder, STB_SPRINTF_MIN + 1)) {
+        return NULL;
     }
+    return builder->data + builder->length;
+}
 
-    literal result = {
-        .data = (const char*) temporary_alloc(out + 1, align1),
-        .count = out,
-    };
+void string_builder_vprint(string_builder_t* builder, char const *fmt, va_list va) {
+    if (!reserve(builder, STB_SPRINTF_MIN + 1)) {
+        return;
+    }
+    stbsp_vsprintfcb(builder_callback, builder, builder->data + builder->length, fmt, va);
+}
 
-    {
-        va_list va;
-        va_start(va, fmt);
+void string_builder_print(string_builder_t* builder, char const *fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+    string_builder_vprint(builder, fmt, va);
+    va_end(va);
+}
 
-        out = stbsp_vsnprintf((char*) result.data, out + 1, fmt, va);
-        va_end(va);
+void string_builder_append(string_builder_t* builder, literal string) {
+    if (!reserve(builder, (u32) string.count + 1)) {
+        return;
+    }
+    memcpy(builder->data + builder->length, string.data, string.count);
+    builder->length += (u32) string.count;
+}
 
-        assert((int) result.count == out);
+literal string_builder_finish(string_builder_t* builder) {
+    if (!reserve(builder, 1) && builder->data == NULL) {
+        return (literal) { .data = "", .count = 0 };
+    }
+    builder->data[builder->length] = '\0';
+
+    // @Note: the rest of the last chunk goes back, unless something else was allocated after the string.
+    u32 size = builder->length + 1;
+    switch (builder->storage) {
+        case STRING_STORAGE_TEMPORARY: temporary_extend(builder->data, builder->capacity, size);       break;
+        case STRING_STORAGE_ARENA:     arena_extend(builder->arena, builder->data, builder->capacity, size); break;
+        case STRING_STORAGE_HEAP:      break;
     }
 
-    return result;
+    return (literal) { .data = builder->data, .count = builder->length };
 }
 
-static literal tprint_va(char const *fmt, va_list va1, va_list va2)
+literal sprint(char const *fmt, ...)
 {
-    auto out = stbsp_vsnprintf(NULL, 0, fmt, va1);
+    string_builder_t builder;
+    string_builder_init(&builder, STRING_STORAGE_HEAP, NULL);
 
-    literal result = {};
-    result.data    = (const char*) temporary_alloc(out + 1, align1);
-    result.count   = out;
+    va_list va;
+    va_start(va, fmt);
+    string_builder_vprint(&builder, fmt, va);
+    va_end(va);
 
-    out = stbsp_vsnprintf((char*) result.data, out + 1, fmt, va2);
-    assert((int) result.count == out);
-    return result;
+    return string_builder_finish(&builder);
+}
+
+literal tprint(char const *fmt, ...)
+{
+    string_builder_t builder;
+    string_builder_init(&builder, STRING_STORAGE_TEMPORARY, NULL);
+
+    va_list va;
+    va_start(va, fmt);
+    string_builder_vprint(&builder, fmt, va);
+    va_end(va);
+
+    return string_builder_finish(&builder);
 }
 
 void print(char const *fmt, ...) {
-    literal string;
-    {
-        va_list va1, va2 ;
-        va_start(va1, fmt);
-        va_copy(va2, va1);
+    // @Note: the string is gone once it's written out, so printing doesn't use up temporary storage.
+    TEMPORARY_SCOPE {
+        string_builder_t builder;
+        string_builder_init(&builder, STRING_STORAGE_TEMPORARY, NULL);
 
-        string = tprint_va(fmt, va1, va2);
+        va_list va;
+        va_start(va, fmt);
+        string_builder_vprint(&builder, fmt, va);
+        va_end(va);
 
-        va_end(va1);
-        va_end(va2);
-    }
+        string_builder_append(&builder, lit("\n"));
+        literal string = string_builder_finish(&builder);
 
-    puts(string.data);
+        // @Note: one write of the whole line, like puts but without formatting twice to size it first.
+        fwrite(string.data, 1, string.count, stdout);
+    }
 }
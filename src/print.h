@@ -2,10 +2,52 @@
 
 #include "types.h"
 
+#include <stdarg.h>
+
+struct memory_arena_t;
+
+//
+// Formats straight into memory that grows in STRING_BUILDER_CHUNK steps, in one pass over the format.
+// Several pieces appended one after another end up in one contiguous, zero terminated literal.
+//
+// Temporary and arena builders grow in place while nothing else was allocated after them, otherwise they move.
+//
+
+enum {
+    STRING_BUILDER_CHUNK = 1024, // @Note: at least STB_SPRINTF_MIN + 1, stb_sprintf writes up to that much before handing it back.
+};
+
+typedef enum {
+    STRING_STORAGE_TEMPORARY = 0,
+    STRING_STORAGE_ARENA,
+    STRING_STORAGE_HEAP, // malloc, the caller frees the data of the result.
+} string_storage_t;
+
+typedef struct {
+    char* data;
+    u32 length;
+    u32 capacity;
+    bool truncated; // the storage ran out, everything after that was dropped.
+
+    string_storage_t storage;
+    struct memory_arena_t* arena;
+} string_builder_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+void string_builder_init(string_builder_t* builder, string_storage_t storage, struct memory_arena_t* arena);
+
+void string_builder_print(string_builder_t* builder, char const *fmt, ...);
+void string_builder_vprint(string_builder_t* builder, char const *fmt, va_list va);
+void string_builder_append(string_builder_t* builder, literal string);
+
+//
+// Zero terminates and trims the storage down to the string, the builder shouldn't be used after that.
+//
+literal string_builder_finish(string_builder_t* builder);
+
 literal sprint(char const *fmt, ...);
 literal tprint(char const *fmt, ...);
 void     print(const char* fmt, ...);
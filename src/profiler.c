@@ -0,0 +1,144 @@
+#include "profiler.h"
+#include "base.h"
+#include "stb_sprintf.h"
+
+#include <stdlib.h>
+
+
+profiler_t profiler;
+
+// World units, y goes up.
+static const f32 OVERLAY_X = 0.70f;
+static const f32 OVERLAY_Y = 0.70f;
+static const f32 OVERLAY_W = 0.29f;
+static const f32 OVERLAY_H = 0.28f;
+
+static const f32 OVERLAY_TEXT_SIZE   = 14.0f;
+static const f32 OVERLAY_LINE_HEIGHT = 0.025f;
+static const f32 OVERLAY_MARGIN      = 0.008f;
+
+enum {
+    OVERLAY_BACKGROUND = 0xff111111,
+    OVERLAY_GRAPH      = 0xff1f1f1f,
+    OVERLAY_BAR        = 0xff3fbf3f,
+    OVERLAY_BAR_P99    = 0xffdb0f10, // frames at or above the 99th percentile.
+    OVERLAY_TEXT       = 0xffffffff,
+
+    OVERLAY_LINES         = 3,
+    OVERLAY_LINE_CAPACITY = 128,
+};
+
+void profiler_set_enabled(bool enabled) {
+    profiler.enabled = enabled;
+}
+
+void profiler_end_frame(u64 pixels, s32 commands) {
+    if (!profiler.enabled) {
+        return;
+    }
+
+    profile_frame_t* frame = &profiler.frames[profiler.next];
+    *frame = (profile_frame_t) { .pixels = pixels, .commands = commands };
+
+    for (s32 i = 0; i < PROFILE_ZONE_COUNT; i++) {
+        frame->ns[i]   = atomic_exchange_explicit(&profiler.ns[i],   0, memory_order_relaxed);
+        frame->hits[i] = atomic_exchange_explicit(&profiler.hits[i], 0, memory_order_relaxed);
+    }
+
+    profiler.next  = (profiler.next + 1) % PROFILER_FRAMES;
+    profiler.count = min(profiler.count + 1, (s32) PROFILER_FRAMES);
+}
+
+// i-th frame back from the most recent one.
+static const profile_frame_t* frame_back(s32 i) {
+    return &profiler.frames[(profiler.next - 1 - i + PROFILER_FRAMES) % PROFILER_FRAMES];
+}
+
+const profile_frame_t* profiler_last_frame() {
+    return profiler.count > 0 ? frame_back(0) : NULL;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    u64 x = *(const u64*) a;
+    u64 y = *(const u64*) b;
+    return (x > y) - (x < y);
+}
+
+profile_summary_t profiler_summary() {
+    profile_summary_t summary = { .frames = profiler.count };
+    if (profiler.count == 0) {
+        return summary;
+    }
+
+    u64 ns[PROFILER_FRAMES];
+    for (s32 i = 0; i < profiler.count; i++) {
+        ns[i] = frame_back(i)->ns[PROFILE_EXECUTE];
+    }
+    qsort(ns, (size_t) profiler.count, sizeof(u64), compare_u64);
+
+    summary.p50_ns = ns[(profiler.count - 1) * 50 / 100];
+    summary.p99_ns = ns[(profiler.count - 1) * 99 / 100];
+    summary.max_ns = ns[profiler.count - 1];
+    return summary;
+}
+
+static void add_box(command_buffer_t* commands, f32 x, f32 y, f32 w, f32 h, u32 color) {
+    add_command(commands, (command_t) {
+        .type = COMMAND_TYPE_DRAW_BOX,
+        .box  = { .x = x, .y = y, .w = w, .h = h, .color = color },
+    });
+}
+
+void profiler_add_overlay(command_buffer_t* commands) {
+    // @Note: text commands don't own their strings, these stay around until the next overlay.
+    static char lines[OVERLAY_LINES][OVERLAY_LINE_CAPACITY];
+
+    profile_summary_t summary = profiler_summary();
+    const profile_frame_t* last = profiler_last_frame();
+    if (last == NULL) {
+        return;
+    }
+
+    add_box(commands, OVERLAY_X, OVERLAY_Y, OVERLAY_W, OVERLAY_H, OVERLAY_BACKGROUND);
+
+    f32 top = OVERLAY_Y + OVERLAY_H;
+
+    stbsp_snprintf(lines[0], OVERLAY_LINE_CAPACITY, "frame p50 %.2f  p99 %.2f  max %.2f ms",
+                   (f64) summary.p50_ns / 1e6, (f64) summary.p99_ns / 1e6, (f64) summary.max_ns / 1e6);
+    stbsp_snprintf(lines[1], OVERLAY_LINE_CAPACITY, "%llu pixels, %d commands",
+                   (unsigned long long) last->pixels, last->commands);
+    stbsp_snprintf(lines[2], OVERLAY_LINE_CAPACITY, "dispatch %.2f  alloc %.2f  commit %.2f ms",
+                   (f64) last->ns[PROFILE_DISPATCH] / 1e6, (f64) last->ns[PROFILE_ALLOCATE] / 1e6, (f64) last->ns[PROFILE_COMMIT] / 1e6);
+
+    for (s32 i = 0; i < OVERLAY_LINES; i++) {
+        add_command(commands, (command_t) {
+            .type = COMMAND_TYPE_DRAW_TEXT,
+            .text = {
+                .x      = OVERLAY_X + OVERLAY_MARGIN,
+                .y      = top - (f32) (i + 1) * OVERLAY_LINE_HEIGHT,
+                .string = lines[i],
+                .color  = OVERLAY_TEXT,
+                .size   = OVERLAY_TEXT_SIZE,
+            },
+        });
+    }
+
+    // Graph of the last frames, oldest on the left, scaled to the slowest one of the whole ring.
+    f32 graph_x = OVERLAY_X + OVERLAY_MARGIN;
+    f32 graph_y = OVERLAY_Y + OVERLAY_MARGIN;
+    f32 graph_w = OVERLAY_W - 2 * OVERLAY_MARGIN;
+    f32 graph_h = top - (f32) OVERLAY_LINES * OVERLAY_LINE_HEIGHT - OVERLAY_MARGIN - graph_y;
+
+    add_box(commands, graph_x, graph_y, graph_w, graph_h, OVERLAY_GRAPH);
+
+    s32 bars = min(profiler.count, (s32) PROFILER_GRAPH_FRAMES);
+    f32 bar_w = graph_w / PROFILER_GRAPH_FRAMES;
+
+    for (s32 i = 0; i < bars; i++) {
+        u64 ns = frame_back(i)->ns[PROFILE_EXECUTE];
+        f32 h  = summary.max_ns ? graph_h * (f32) ((f64) ns / (f64) summary.max_ns) : 0.0f;
+
+        f32 x = graph_x + graph_w - (f32) (i + 1) * bar_w;
+        add_box(commands, x, graph_y, bar_w, h, ns >= summary.p99_ns ? OVERLAY_BAR_P99 : OVERLAY_BAR);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+//
+// Frame timing: zones measured with the monotonic clock, summed per frame and kept for the last PROFILER_FRAMES frames.
+//
+// Everything here is compiled out unless HAS_PROFILER is defined (meson -Dprofiler=true), PROFILE_BEGIN/PROFILE_END become nothing then.
+// With it, a disabled profiler costs a load and a branch per zone.
+//
+// @Note: primitives are drawn on the tile renderer threads, their zones are summed over all of the threads,
+// so together they can take longer than the frame did.
+//
+
+typedef enum {
+    PROFILE_EXECUTE = 0, // from building the frame until it's committed, this is the frame time.
+    PROFILE_DRAW_BOX,    // one per primitive type, in the order of command_type_t.
+    PROFILE_DRAW_CIRCLE,
+    PROFILE_DRAW_DISK,
+    PROFILE_DRAW_TEXT,
+    PROFILE_DISPATCH,    // wl_display_dispatch_pending since the last frame.
+    PROFILE_ALLOCATE,    // acquiring and resizing framebuffers.
+    PROFILE_COMMIT,      // attach, damage and commit.
+
+    PROFILE_ZONE_COUNT,
+} profile_zone_t;
+
+enum {
+    PROFILER_FRAMES = 256, // @Note: ring of frame samples, the percentiles are over all of them.
+
+    PROFILER_GRAPH_FRAMES = 64,
+};
+
+typedef struct {
+    u64 ns[PROFILE_ZONE_COUNT];
+    u32 hits[PROFILE_ZONE_COUNT];
+    u64 pixels;
+    s32 commands;
+} profile_frame_t;
+
+typedef struct {
+    s32 frames;
+    u64 p50_ns;
+    u64 p99_ns;
+    u64 max_ns;
+} profile_summary_t;
+
+typedef struct {
+    bool enabled;
+
+    // Current frame, zones can end on any thread.
+    atomic_uint_fast64_t ns[PROFILE_ZONE_COUNT];
+    atomic_uint          hits[PROFILE_ZONE_COUNT];
+
+    profile_frame_t frames[PROFILER_FRAMES];
+    s32 next;  // where the next frame goes.
+    s32 count;
+} profiler_t;
+
+extern profiler_t profiler;
+
+static inline u64 profiler_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+// 0 when disabled, so that the end of the zone doesn't need to look at the flag again.
+static inline u64 profiler_begin() {
+    return profiler.enabled ? profiler_now_ns() : 0;
+}
+
+static inline void profiler_end(profile_zone_t zone, u64 start) {
+    if (start) {
+        atomic_fetch_add_explicit(&profiler.ns[zone], profiler_now_ns() - start, memory_order_relaxed);
+        atomic_fetch_add_explicit(&profiler.hits[zone], 1, memory_order_relaxed);
+    }
+}
+
+#ifdef HAS_PROFILER
+#define PROFILE_BEGIN(name)      u64 profile_##name = profiler_begin()
+#define PROFILE_END(name, zone)  profiler_end((zone), profile_##name)
+#else
+#define PROFILE_BEGIN(name)
+#define PROFILE_END(name, zone)
+#endif
+
+void profiler_set_enabled(bool enabled);
+
+//
+// Moves the zones of the current frame into the ring, together with what the frame drew.
+//
+void profiler_end_frame(u64 pixels, s32 commands);
+
+const profile_frame_t* profiler_last_frame();
+profile_summary_t profiler_summary();
+
+//
+// Adds a box with the frame time graph of the last PROFILER_GRAPH_FRAMES frames, the percentiles and the per frame counts
+// into the top right corner, drawn with the same boxes and text as everything else.
+// @Note: opaque, so it doesn't accumulate when it's drawn over itself every frame.
+//
+void profiler_add_overlay(command_buffer_t* commands);
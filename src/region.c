@@ -0,0 +1,126 @@
+#include "region.h"
+#include "base.h"
+
+#include <assert.h>
+
+
+enum {
+    // @Note: touching rects are merged when the pixels that the union adds are at most 1/REGION_MERGE_SLACK of the ones they cover.
+    REGION_MERGE_SLACK = 4,
+};
+
+void region_init(region_t* region, s32 budget, rectangle_t clip) {
+    assert(budget >= 1 && budget <= MAX_REGION_RECTS);
+
+    *region = (region_t) {
+        .budget = budget,
+        .clip   = clip,
+    };
+}
+
+void region_clear(region_t* region) {
+    region->count = 0;
+}
+
+static u64 rectangle_area(rectangle_t rect) {
+    return rectangle_is_empty(rect) ? 0 : (u64) rect.w * rect.h;
+}
+
+static rectangle_t union_rectangles(rectangle_t a, rectangle_t b) {
+    s32 x0 = min(a.x, b.x);
+    s32 y0 = min(a.y, b.y);
+    s32 x1 = max(a.x + a.w, b.x + b.w);
+    s32 y1 = max(a.y + a.h, b.y + b.h);
+
+    return (rectangle_t) { .x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0 };
+}
+
+// Overlapping or sharing an edge.
+static bool rectangles_touch(rectangle_t a, rectangle_t b) {
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+static u64 covered_area(rectangle_t a, rectangle_t b) {
+    return rectangle_area(a) + rectangle_area(b) - rectangle_area(intersect_rectangles(a, b));
+}
+
+// Pixels that the union of a and b covers but neither of them does.
+static u64 merge_waste(rectangle_t a, rectangle_t b) {
+    return rectangle_area(union_rectangles(a, b)) - covered_area(a, b);
+}
+
+static void remove_rect(region_t* region, s32 index) {
+    region->rects[index] = region->rects[--region->count];
+}
+
+void region_add(region_t* region, rectangle_t rect) {
+    rect = intersect_rectangles(rect, region->clip);
+    if (rectangle_is_empty(rect)) {
+        return;
+    }
+
+    //
+    // @Note: a merged rect can reach rects that the original one didn't, so keep going until nothing merges.
+    // Rects contained in one another have no waste, so they are handled here too.
+    //
+    bool merged = true;
+    while (merged) {
+        merged = false;
+
+        for (s32 i = 0; i < region->count; i++) {
+            rectangle_t other = region->rects[i];
+            if (!rectangles_touch(rect, other)) continue;
+
+            if (merge_waste(rect, other) * REGION_MERGE_SLACK <= covered_area(rect, other)) {
+                rect = union_rectangles(rect, other);
+                remove_rect(region, i);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    region->rects[region->count++] = rect;
+
+    while (region->count > region->budget) {
+        s32 best_a = 0;
+        s32 best_b = 1;
+        u64 best   = UINT64_MAX;
+
+        for (s32 a = 0; a < region->count; a++) {
+            for (s32 b = a + 1; b < region->count; b++) {
+                u64 waste = merge_waste(region->rects[a], region->rects[b]);
+                if (waste < best) {
+                    best   = waste;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+
+        region->rects[best_a] = union_rectangles(region->rects[best_a], region->rects[best_b]);
+        remove_rect(region, best_b);
+    }
+}
+
+bool region_is_empty(const region_t* region) {
+    return region->count == 0;
+}
+
+bool region_covers(const region_t* region, rectangle_t rect) {
+    for (s32 i = 0; i < region->count; i++) {
+        rectangle_t inside = intersect_rectangles(rect, region->rects[i]);
+        if (inside.x == rect.x && inside.y == rect.y && inside.w == rect.w && inside.h == rect.h) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u64 region_area(const region_t* region) {
+    u64 area = 0;
+    for (s32 i = 0; i < region->count; i++) {
+        area += rectangle_area(region->rects[i]);
+    }
+    return area;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+
+//
+// Damage of one frame as a small set of disjoint-ish rects.
+//
+// Overlapping and touching rects are merged when their union doesn't cover much more than the two of them,
+// and once there are more than budget rects the pair that wastes the fewest pixels is merged, until it fits.
+// The rects may cover a few pixels that were not damaged, but never miss one that was.
+//
+
+enum {
+    MAX_REGION_RECTS           = 32,
+    REGION_DEFAULT_RECT_BUDGET = 8,
+};
+
+typedef struct {
+    rectangle_t rects[MAX_REGION_RECTS + 1]; // @Note: room for the rect being added before the budget is enforced.
+    s32 count;
+    s32 budget;       // 1 .. MAX_REGION_RECTS.
+    rectangle_t clip; // everything outside of it is dropped, usually the buffer.
+} region_t;
+
+void region_init(region_t* region, s32 budget, rectangle_t clip);
+void region_clear(region_t* region);
+void region_add(region_t* region, rectangle_t rect);
+
+bool region_is_empty(const region_t* region);
+bool region_covers(const region_t* region, rectangle_t rect); // rect is inside of a single rect of the region.
+u64  region_area(const region_t* region);
@@ -0,0 +1,702 @@
+#include "render.h"
+#include "base.h"
+#include "span_fill.h"
+#include "blend.h"
+#include "log.h"
+#include "glyph_atlas.h"
+#include "text_run_cache.h"
+#include "texture.h"
+#include "memory_arena.h"
+#include "profiler.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+
+// @Note: f1 and f2 are the size of the buffer, surface_width and surface_height the size of the surface it's shown at.
+static float ortho_projection_f1;
+static float ortho_projection_f2;
+static float ortho_surface_width;
+static float ortho_surface_height;
+static float ortho_scale = 1.0f;
+
+s32 scale_to_buffer(s32 size, f32 scale) {
+    return (s32) floorf((f32) size * scale + 0.5f);
+}
+
+void update_orthographic_projection(int32_t width, int32_t height, f32 scale) {
+    ortho_projection_f1  = (float) scale_to_buffer(width,  scale);
+    ortho_projection_f2  = (float) scale_to_buffer(height, scale);
+    ortho_surface_width  = (float) width;
+    ortho_surface_height = (float) height;
+    ortho_scale          = scale;
+}
+
+bool valid_orthographic_projection() {
+    return ortho_projection_f1 != 0.0f && ortho_projection_f2 != 0.0f;
+}
+
+f32 projection_scale() {
+    return ortho_scale;
+}
+
+void transform_screen_into_world(double* x, double* y) {
+    *x =         *x / ortho_surface_width;
+    *y = 1.0f - (*y / ortho_surface_height);
+}
+
+void transform_world_into_screen(float* x, float* y) {
+    *x = *x          * ortho_projection_f1;
+    *y = (1.0f - *y) * ortho_projection_f2;
+}
+
+static void transform_world_into_screen_rect(float* x, float* y, float* w, float* h) {
+
+    float origin_x = *x;
+    float origin_y = *y;
+
+    *x = clamp(*x, 0.0f, 1.0f);
+    *y = clamp(*y, 0.0f, 1.0f);
+    *w = clamp(*w, 0.0f, 1.0f);
+    *h = clamp(*h, 0.0f, 1.0f);
+
+
+    *x =       *x  * ortho_projection_f1;
+    *y = (1.0f-*y) * ortho_projection_f2;
+    *w =       *w  * ortho_projection_f1;
+    *h =       *h  * ortho_projection_f2;
+
+    if (origin_x == 1.0f) { // since we are writing into our buffer, we don't want to include the very last bit.
+        *x -= 1;
+    }
+
+    if (origin_y == 0.0f) {
+        *y -= 1;
+    }
+}
+
+static void transform_world_into_screen_circle(float* x, float* y, float* r) {
+
+    float origin_x = *x;
+    float origin_y = *y;
+
+    *x = clamp(*x, 0.0f, 1.0f);
+    *y = clamp(*y, 0.0f, 1.0f);
+    *r = clamp(*r, 0.0f, 1.0f);
+
+    *x =       *x  * ortho_projection_f1;
+    *y = (1.0f-*y) * ortho_projection_f2;
+    *r =       *r  * min(ortho_projection_f1, ortho_projection_f2);
+
+    if (origin_x == 1.0f) { // since we are writing into our buffer, we don't want to include the very last bit.
+        *x -= 1;
+    }
+
+    if (origin_y == 0.0f) {
+        *y -= 1;
+    }
+}
+
+static void transform_screen_into_world_disk(float* x, float* y, float* r0, float* r1) {
+
+    f32 origin_x = *x;
+    f32 origin_y = *y;
+
+    *x  = clamp(*x,  0.0f, 1.0f);
+    *y  = clamp(*y,  0.0f, 1.0f);
+    *r0 = clamp(*r0, 0.0f, 1.0f);
+    *r1 = clamp(*r1, 0.0f, 1.0f);
+
+    *x  =       *x  * ortho_projection_f1;
+    *y  = (1.0f-*y) * ortho_projection_f2;
+    *r0 =      *r0  * min(ortho_projection_f1, ortho_projection_f2);
+    *r1 =      *r1  * min(ortho_projection_f1, ortho_projection_f2);
+
+    if (origin_x == 1.0f) { // since we are writing into our buffer, we don't want to include the very last bit.
+        *x -= 1.0f;
+    }
+
+    if (origin_y == 0.0f) {
+        *y -= 1.0f;
+    }
+}
+
+
+uint32_t make_u32_from_color(color_t color) {
+    uint32_t aa = (uint8_t) (color.a * 255.0f);
+    uint32_t rr = (uint8_t) (color.r * 255.0f);
+    uint32_t gg = (uint8_t) (color.g * 255.0f);
+    uint32_t bb = (uint8_t) (color.b * 255.0f);
+
+    return (aa << 24) | (rr << 16) | (gg << 8) | (bb << 0);
+}
+
+
+uint32_t make_u32_from_u8(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    uint32_t aa = a;
+    uint32_t rr = r;
+    uint32_t gg = g;
+    uint32_t bb = b;
+
+    return (aa << 24) | (rr << 16) | (gg << 8) | (bb << 0);
+}
+
+
+rectangle_t intersect_rectangles(rectangle_t a, rectangle_t b) {
+    s32 x0 = max(a.x, b.x);
+    s32 y0 = max(a.y, b.y);
+    s32 x1 = min(a.x + a.w, b.x + b.w);
+    s32 y1 = min(a.y + a.h, b.y + b.h);
+
+    if (x1 <= x0 || y1 <= y0) {
+        return (rectangle_t) {};
+    }
+
+    return (rectangle_t) { .x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0 };
+}
+
+bool rectangle_is_empty(rectangle_t rect) {
+    return rect.w <= 0 || rect.h <= 0;
+}
+
+rectangle_t buffer_rectangle(buffer_t* buffer) {
+    return (rectangle_t) { .x = 0, .y = 0, .w = buffer->width, .h = buffer->height };
+}
+
+// @Note: y is the bottom row of the box, rows [y-h, y] are filled.
+static rectangle_t box_rectangle(s32 x, s32 y, s32 w, s32 h) {
+    return (rectangle_t) { .x = x, .y = y - h, .w = w, .h = h + 1 };
+}
+
+static void draw_box_internal(buffer_t* buffer, s32 x, s32 y, s32 w, s32 h, u32 c, rectangle_t clip) {
+    //
+    // @Incomplete: check_buffer_is_not_used_by_the_compositor. Same for all other draw_* functions.
+    //
+
+    rectangle_t rect = intersect_rectangles(box_rectangle(x, y, w, h), clip);
+    if (rectangle_is_empty(rect)) {
+        return;
+    }
+
+    u8 alpha = (u8) (c >> 24);
+
+    if (alpha == 0xFF) {
+        fill_rect(buffer->data + (rect.y * buffer->width + rect.x), buffer->width, rect.w, rect.h, c);
+        return;
+    }
+
+    for (s32 row = rect.y; row < rect.y + rect.h; row++) {
+        blend_span_solid(buffer->data + (row * buffer->width + rect.x), c, alpha, rect.w);
+    }
+}
+
+//
+// @Note: circles and disks are rasterized one row at a time. For every row the pixels are split by their distance to the center into runs:
+// fully inside runs are filled (or blended if the color is translucent), and only the few edge pixels in between get the antialiasing math,
+// their coverage is gathered per run and blended against the framebuffer in one go.
+//
+
+typedef struct {
+    f32 threshold; // squared radius the intensity is measured from.
+    f32 scale;
+    bool inner;    // inner edge of a ring, intensity grows with the distance.
+} circle_edge_t;
+
+// Largest k >= 0 with k*k <= limit, -1 if there is none.
+static s32 max_offset_within(s64 limit) {
+    if (limit < 0) {
+        return -1;
+    }
+
+    s32 k = (s32) sqrt((f64) limit);
+    while ((s64) k * k > limit)             k--;
+    while ((s64) (k+1) * (k+1) <= limit)    k++;
+    return k;
+}
+
+// Pixels with k_lo < |x - x0| <= k_hi, as at most two runs of [first, last].
+static s32 symmetric_runs(s32 x0, s32 k_lo, s32 k_hi, s32 runs[2][2]) {
+    if (k_hi <= k_lo) {
+        return 0;
+    }
+
+    if (k_lo < 0) {
+        runs[0][0] = x0 - k_hi;
+        runs[0][1] = x0 + k_hi;
+        return 1;
+    }
+
+    runs[0][0] = x0 - k_hi;
+    runs[0][1] = x0 - k_lo - 1;
+    runs[1][0] = x0 + k_lo + 1;
+    runs[1][1] = x0 + k_hi;
+    return 2;
+}
+
+static bool clip_row_run(rectangle_t clip, s32 y, s32* first, s32* last) {
+    if (y < clip.y || y >= clip.y + clip.h) {
+        return false;
+    }
+
+    *first = max(*first, clip.x);
+    *last  = min(*last,  clip.x + clip.w - 1);
+    return *first <= *last;
+}
+
+static void draw_circle_fill_runs(buffer_t* buffer, s32 x0, s32 y, s32 k_lo, s32 k_hi, u32 c, rectangle_t clip) {
+    s32 runs[2][2];
+    s32 run_count = symmetric_runs(x0, k_lo, k_hi, runs);
+
+    for (s32 run = 0; run < run_count; run++) {
+        s32 first = runs[run][0];
+        s32 last  = runs[run][1];
+
+        if (clip_row_run(clip, y, &first, &last)) {
+            blend_span_solid(buffer->data + (y * buffer->width + first), c, (u8) (c >> 24), (u32) (last - first + 1));
+        }
+    }
+}
+
+static void draw_circle_edge_runs(buffer_t* buffer, s32 x0, s32 y, s32 sqy, s32 k_lo, s32 k_hi, circle_edge_t edge, u32 c, rectangle_t clip) {
+    s32 runs[2][2];
+    s32 run_count = symmetric_runs(x0, k_lo, k_hi, runs);
+
+    for (s32 run = 0; run < run_count; run++) {
+        s32 first = runs[run][0];
+        s32 last  = runs[run][1];
+
+        if (!clip_row_run(clip, y, &first, &last)) {
+            continue;
+        }
+
+        u8 coverage[256];
+
+        for (s32 chunk = first; chunk <= last; chunk += (s32) static_array_size(coverage)) {
+            s32 count = min(last - chunk + 1, (s32) static_array_size(coverage));
+
+            for (s32 i = 0; i < count; i++) {
+                s32 x = chunk + i;
+                s32 distance = (x-x0) * (x-x0) + sqy;
+
+                float intensity = edge.inner
+                    ? (distance - edge.threshold - 0.5f) / edge.scale
+                    : (edge.threshold - distance + 0.5f) / edge.scale; // +0.5f to round up.
+
+                coverage[i] = (u8) (clamp(intensity, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+
+            blend_span_coverage(buffer->data + (y * buffer->width + chunk), c, coverage, (u32) count);
+        }
+    }
+}
+
+static void draw_circle_internal(buffer_t* buffer, s32 x0, s32 y0, s32 r, u32 c, rectangle_t clip) {
+    s32 r_inner = r*r - r; // Approximation of (r - 0.5)^2 = r*r - 2*r + 0.25 = r*r - r
+    s32 r_outer = r*r + r; // Approximation of (r + 0.5)^2 = r*r + 2*r + 0.25 = r*r + r
+
+    circle_edge_t edge = { .threshold = (f32) r_outer, .scale = 2.0f*r };
+
+    for (s32 y = max(y0-r, clip.y); y <= min(y0+r, clip.y+clip.h-1); y++) {
+        s32 sqy = (y-y0) * (y-y0);
+
+        s32 inside  = min(max_offset_within(r_inner - sqy),     r); // distance <= r_inner
+        s32 outside = min(max_offset_within(r_outer - sqy - 1), r); // distance <  r_outer
+
+        draw_circle_fill_runs(buffer, x0, y, -1, inside, c, clip);
+        draw_circle_edge_runs(buffer, x0, y, sqy, inside, outside, edge, c, clip);
+    }
+}
+
+static void draw_disk_internal(buffer_t* buffer, s32 x0, s32 y0, s32 r0, s32 r1, u32 c, rectangle_t clip) {
+    assert(r0 < r1 && "Inner radius should be always less than outer radius");
+
+    s32 r0_inner = r0*r0 - r0;
+    s32 r0_outer = r0*r0 + r0;
+
+    s32 r1_inner = r1*r1 - r1;
+    s32 r1_outer = r1*r1 + r1;
+
+    circle_edge_t edge0 = { .threshold = (f32) r0_inner, .scale = 2.0f*r0, .inner = true };
+    circle_edge_t edge1 = { .threshold = (f32) r1_outer, .scale = 2.0f*r1 };
+
+    for (s32 y = max(y0-r1, clip.y); y <= min(y0+r1, clip.y+clip.h-1); y++) {
+        s32 sqy = (y-y0) * (y-y0);
+
+        s32 hole        = min(max_offset_within(r0_inner - sqy),     r1); // distance <= r0_inner
+        s32 inner_edge  = min(max_offset_within(r0_outer - sqy - 1), r1); // distance <  r0_outer
+        s32 ring        = min(max_offset_within(r1_inner - sqy),     r1); // distance <= r1_inner
+        s32 outer_edge  = min(max_offset_within(r1_outer - sqy - 1), r1); // distance <  r1_outer
+
+        inner_edge = max(inner_edge, hole);
+        ring       = max(ring,       inner_edge);
+
+        draw_circle_edge_runs(buffer, x0, y, sqy, hole, inner_edge, edge0, c, clip);
+        draw_circle_fill_runs(buffer, x0, y, inner_edge, ring, c, clip);
+        draw_circle_edge_runs(buffer, x0, y, sqy, ring, outer_edge, edge1, c, clip);
+    }
+}
+
+static void box_into_screen(float x, float y, float w, float h, s32* x0, s32* y0, s32* w0, s32* h0) {
+    transform_world_into_screen_rect(&x, &y, &w, &h);
+    *x0 = (s32) x;
+    *y0 = (s32) y;
+    *w0 = (s32) w;
+    *h0 = (s32) h;
+}
+
+static void circle_into_screen(float x, float y, float r, s32* x0, s32* y0, s32* r0) {
+    transform_world_into_screen_circle(&x, &y, &r);
+    *x0 = (s32) x;
+    *y0 = (s32) y;
+    *r0 = (s32) r;
+}
+
+static void disk_into_screen(float x, float y, float ri, float ro, s32* x0, s32* y0, s32* r0, s32* r1) {
+    transform_screen_into_world_disk(&x, &y, &ri, &ro);
+    *x0 = (s32) x;
+    *y0 = (s32) y;
+    *r0 = (s32) ri;
+    *r1 = (s32) ro;
+}
+
+
+static glyph_atlas_t glyph_atlas;
+static s32 default_font = -1;
+
+static text_run_cache_t text_runs;
+
+static bool load_default_font() {
+    static bool first_time = true;
+
+    if (first_time) {
+
+        // @Incomplete: abstract this away.
+
+        first_time = false;
+
+        glyph_atlas_init(&glyph_atlas);
+
+        const char* path = "/usr/share/fonts/rsms-inter-fonts/Inter-Regular.ttf";
+        default_font = glyph_atlas_add_font(&glyph_atlas, path);
+        if (default_font == -1) {
+            log_error(LOG_TEXT, "Couldn't open font '%s', text is not going to be drawn.", path);
+            return false;
+        }
+    }
+
+    return default_font != -1;
+}
+
+text_run_cache_t* get_text_run_cache() {
+    if (text_runs.lru.lru_next == NULL) {
+        text_run_cache_init(&text_runs, TEXT_RUN_CACHE_DEFAULT_BUDGET);
+    }
+    return &text_runs;
+}
+
+void render_begin_frame() {
+    if (default_font != -1) {
+        glyph_atlas_begin_frame(&glyph_atlas);
+        text_run_cache_begin_frame(get_text_run_cache());
+    }
+}
+
+// @Note: sizes are in surface pixels, glyphs are rasterized at the buffer resolution so text stays sharp when scaled.
+static f32 text_size(f32 size) {
+    return (size > 0.0f ? size : DEFAULT_FONT_SIZE) * ortho_scale;
+}
+
+// Same placement as stbtt_GetPackedQuad with align_to_integer.
+static textured_quad_t glyph_quad(const glyph_t* glyph, f32* x, f32 y) {
+    f32 ipw = 1.0f / GLYPH_ATLAS_PAGE_SIZE;
+    f32 iph = 1.0f / GLYPH_ATLAS_PAGE_SIZE;
+
+    f32 x0 = floorf(*x + glyph->xoff + 0.5f);
+    f32 y0 = floorf(y  + glyph->yoff + 0.5f);
+
+    textured_quad_t q = {
+        .x0 = x0,
+        .y0 = y0,
+        .x1 = x0 + glyph->xoff2 - glyph->xoff,
+        .y1 = y0 + glyph->yoff2 - glyph->yoff,
+        .u0 = glyph->x0 * ipw,
+        .v0 = glyph->y0 * iph,
+        .u1 = glyph->x1 * ipw,
+        .v1 = glyph->y1 * iph,
+    };
+
+    *x += glyph->advance;
+    return q;
+}
+
+//
+// @Note: text is laid out relative to the pen position rounded down to a pixel, so a string gives the same pixels
+// wherever it's drawn, as long as the subpixel phase stays the same. That's what lets the text run cache reuse them.
+//
+typedef struct {
+    s32 origin_x, origin_y;
+    f32 phase_x,  phase_y;
+} text_origin_t;
+
+static text_origin_t text_origin(f32 x, f32 y) {
+    transform_world_into_screen(&x, &y);
+
+    f32 origin_x = floorf(x);
+    f32 origin_y = floorf(y);
+
+    return (text_origin_t) {
+        .origin_x = (s32) origin_x,
+        .origin_y = (s32) origin_y,
+        .phase_x  = x - origin_x,
+        .phase_y  = y - origin_y,
+    };
+}
+
+static rectangle_t offset_rectangle(rectangle_t rect, s32 x, s32 y) {
+    return (rectangle_t) { .x = rect.x + x, .y = rect.y + y, .w = rect.w, .h = rect.h };
+}
+
+static textured_quad_t offset_quad(textured_quad_t quad, f32 x, f32 y) {
+    quad.x0 += x;
+    quad.x1 += x;
+    quad.y0 += y;
+    quad.y1 += y;
+    return quad;
+}
+
+// Bounds relative to the origin.
+static rectangle_t glyph_run_bounds(const char* text, f32 size, text_origin_t origin) {
+    f32 x = origin.phase_x;
+    f32 y = origin.phase_y;
+
+    s32 x0 = INT32_MAX, y0 = INT32_MAX;
+    s32 x1 = INT32_MIN, y1 = INT32_MIN;
+
+    while (*text) {
+        const glyph_t* glyph = glyph_atlas_find(&glyph_atlas, default_font, size, next_codepoint(&text));
+        if (!glyph) continue;
+
+        rectangle_t rect = textured_quad_rectangle(glyph_quad(glyph, &x, y));
+        if (rectangle_is_empty(rect)) continue;
+
+        x0 = min(x0, rect.x);
+        y0 = min(y0, rect.y);
+        x1 = max(x1, rect.x + rect.w);
+        y1 = max(y1, rect.y + rect.h);
+    }
+
+    if (x1 <= x0 || y1 <= y0) {
+        return (rectangle_t) {};
+    }
+
+    return (rectangle_t) { .x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0 };
+}
+
+// Renders the glyphs of the run into its coverage.
+static void composite_text_run(text_run_t* run, const char* text) {
+    f32 x = run->phase_x;
+    f32 y = run->phase_y;
+
+    while (*text) {
+        const glyph_t* glyph = glyph_atlas_find(&glyph_atlas, run->font, run->size, next_codepoint(&text));
+        if (!glyph) continue;
+
+        textured_quad_t quad = glyph_quad(glyph, &x, y);
+        texture_t page       = glyph_atlas_page_texture(&glyph_atlas, glyph->page);
+
+        accumulate_textured_quad(&run->coverage, &page, offset_quad(quad, (f32) -run->rect.x, (f32) -run->rect.y));
+    }
+}
+
+static rectangle_t text_bounds(float x, float y, const char* text, f32 size) {
+    if (!load_default_font()) {
+        return (rectangle_t) {};
+    }
+
+    size = text_size(size);
+    text_origin_t origin = text_origin(x, y);
+
+    text_run_cache_t* cache = get_text_run_cache();
+
+    text_run_t* run = text_run_lookup(cache, default_font, size, origin.phase_x, origin.phase_y, text);
+    if (run) {
+        return offset_rectangle(run->rect, origin.origin_x, origin.origin_y);
+    }
+
+    glyph_atlas_prepare(&glyph_atlas, default_font, size, text);
+
+    rectangle_t rect = glyph_run_bounds(text, size, origin);
+
+    run = text_run_insert(cache, default_font, size, origin.phase_x, origin.phase_y, text, rect);
+    if (run) {
+        composite_text_run(run, text);
+    }
+
+    return offset_rectangle(rect, origin.origin_x, origin.origin_y);
+}
+
+static void draw_text_run(buffer_t* buffer, const text_run_t* run, text_origin_t origin, u32 color, rectangle_t clip) {
+    rectangle_t rect = offset_rectangle(run->rect, origin.origin_x, origin.origin_y);
+
+    textured_quad_t quad = {
+        .x0 = (f32) rect.x,
+        .y0 = (f32) rect.y,
+        .x1 = (f32) (rect.x + rect.w),
+        .y1 = (f32) (rect.y + rect.h),
+        .u0 = 0.0f,
+        .v0 = 0.0f,
+        .u1 = 1.0f,
+        .v1 = 1.0f,
+    };
+
+    draw_textured_quad(buffer, &run->coverage, quad, color, clip);
+}
+
+static void draw_text(buffer_t* buffer, float x, float y, const char* text, f32 size, u32 color, rectangle_t clip) {
+    if (default_font == -1) {
+        return;
+    }
+
+    size = text_size(size);
+    text_origin_t origin = text_origin(x, y);
+
+    //
+    // @Note: runs and glyphs were made by text_bounds, the caches are only read here, since we might be running on a tile thread.
+    //
+    const text_run_t* run = text_run_find(&text_runs, default_font, size, origin.phase_x, origin.phase_y, text);
+    if (run) {
+        draw_text_run(buffer, run, origin, color, clip);
+        return;
+    }
+
+    // Didn't fit into the cache budget, draw glyph by glyph.
+    f32 pen_x = origin.phase_x;
+    f32 pen_y = origin.phase_y;
+
+    while (*text) {
+        const glyph_t* glyph = glyph_atlas_find(&glyph_atlas, default_font, size, next_codepoint(&text));
+        if (!glyph) continue;
+
+        textured_quad_t quad = glyph_quad(glyph, &pen_x, pen_y);
+        texture_t page       = glyph_atlas_page_texture(&glyph_atlas, glyph->page);
+
+        draw_textured_quad(buffer, &page, offset_quad(quad, (f32) origin.origin_x, (f32) origin.origin_y), color, clip);
+    }
+}
+
+
+rectangle_t command_bounds(buffer_t* buffer, const command_t* command) {
+    rectangle_t bounds = {};
+
+    if (command->type == COMMAND_TYPE_DRAW_BOX) {
+        s32 x, y, w, h;
+        box_into_screen(command->box.x, command->box.y, command->box.w, command->box.h, &x, &y, &w, &h);
+
+        bounds = box_rectangle(x, y, w, h);
+
+    } else if (command->type == COMMAND_TYPE_DRAW_CIRCLE) {
+        s32 x, y, r;
+        circle_into_screen(command->circle.x, command->circle.y, command->circle.r, &x, &y, &r);
+
+        bounds = (rectangle_t) { .x = x - r, .y = y - r, .w = 2*r + 1, .h = 2*r + 1 };
+
+    } else if (command->type == COMMAND_TYPE_DRAW_DISK) {
+        s32 x, y, r0, r1;
+        disk_into_screen(command->disk.x, command->disk.y, command->disk.r0, command->disk.r1, &x, &y, &r0, &r1);
+
+        bounds = (rectangle_t) { .x = x - r1, .y = y - r1, .w = 2*r1 + 1, .h = 2*r1 + 1 };
+
+    } else if (command->type == COMMAND_TYPE_DRAW_TEXT) {
+        bounds = text_bounds(command->text.x, command->text.y, command->text.string, command->text.size);
+
+    } else {
+        assert(0 && "Command has to be expanded into primitives before drawing");
+    }
+
+    return intersect_rectangles(bounds, buffer_rectangle(buffer));
+}
+
+void draw_command(buffer_t* buffer, const command_t* command, rectangle_t clip) {
+    PROFILE_BEGIN(draw);
+
+    if (command->type == COMMAND_TYPE_DRAW_BOX) {
+        s32 x, y, w, h;
+        box_into_screen(command->box.x, command->box.y, command->box.w, command->box.h, &x, &y, &w, &h);
+
+        draw_box_internal(buffer, x, y, w, h, command->box.color, clip);
+
+    } else if (command->type == COMMAND_TYPE_DRAW_CIRCLE) {
+        s32 x, y, r;
+        circle_into_screen(command->circle.x, command->circle.y, command->circle.r, &x, &y, &r);
+
+        draw_circle_internal(buffer, x, y, r, command->circle.color, clip);
+
+    } else if (command->type == COMMAND_TYPE_DRAW_DISK) {
+        s32 x, y, r0, r1;
+        disk_into_screen(command->disk.x, command->disk.y, command->disk.r0, command->disk.r1, &x, &y, &r0, &r1);
+
+        draw_disk_internal(buffer, x, y, r0, r1, command->disk.color, clip);
+
+    } else if (command->type == COMMAND_TYPE_DRAW_TEXT) {
+        draw_text(buffer, command->text.x, command->text.y, command->text.string, command->text.size, command->text.color, clip);
+
+    } else {
+        assert(0);
+    }
+
+    PROFILE_END(draw, PROFILE_DRAW_BOX + (command->type - COMMAND_TYPE_DRAW_BOX));
+}
+
+
+void command_buffer_init(command_buffer_t* buffer, memory_arena_t* arena) {
+    *buffer = (command_buffer_t) { .arena = arena };
+}
+
+void command_buffer_reset(command_buffer_t* buffer) {
+    arena_reset(buffer->arena);
+    command_buffer_init(buffer, buffer->arena);
+}
+
+static bool grow_command_buffer(command_buffer_t* buffer) {
+    s32 capacity = max(buffer->capacity * 2, (s32) COMMAND_BUFFER_INITIAL_CAPACITY);
+
+    u32 old_size = (u32) buffer->capacity * sizeof(command_t);
+    u32 new_size = (u32) capacity * sizeof(command_t);
+
+    if (buffer->commands && arena_extend(buffer->arena, buffer->commands, old_size, new_size)) {
+        buffer->capacity = capacity;
+        return true;
+    }
+
+    command_t* commands = arena_try_alloc_uninitialized(buffer->arena, new_size, alignment_of(command_t));
+    if (commands == NULL) {
+        return false;
+    }
+
+    if (buffer->length > 0) {
+        memcpy(commands, buffer->commands, (size_t) buffer->length * sizeof(command_t));
+    }
+    buffer->commands = commands;
+    buffer->capacity = capacity;
+    return true;
+}
+
+void add_command(command_buffer_t* buffer, command_t cmd) {
+    if (buffer->length == buffer->capacity && !grow_command_buffer(buffer)) {
+        assert(buffer->capacity > 0 && "Command arena can't fit a single block of commands");
+        log_warning(LOG_RENDER, "Command buffer is out of memory after %d commands, redrawing everything instead.", buffer->length);
+
+        buffer->commands[0] = (command_t) { .type = COMMAND_TYPE_DRAW_EVERYTHING };
+        buffer->length      = 1;
+    }
+
+    buffer->commands[buffer->length++] = cmd;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "types.h"
+
+typedef struct {
+    float r, g, b, a;
+} color_t;
+
+typedef struct {
+    s32 x, y, w, h;
+} rectangle_t;
+
+typedef struct {
+    s32 x, y, w, h;
+} Rect_s32;
+
+typedef struct {
+    f32 x, y, w, h;
+} Rect_f32;
+
+typedef struct {
+    f32 x, y, r;
+} Circle_f32;
+
+typedef struct {
+    s32 x, y, r;
+} Circle_s32;
+
+typedef struct buffer_t {
+    uint32_t* data;
+    int32_t width, height;
+    struct wl_buffer* buffer;
+} buffer_t;
+
+
+typedef enum {
+    COMMAND_TYPE_NONE = 0,
+    COMMAND_TYPE_DRAW_EVERYTHING,
+    COMMAND_TYPE_DRAW_REGION,     // redraws the part of the layout inside of the rect.
+    COMMAND_TYPE_DRAW_BOX,
+    COMMAND_TYPE_DRAW_CIRCLE,
+    COMMAND_TYPE_DRAW_DISK,
+    COMMAND_TYPE_DRAW_TEXT,
+} command_type_t;
+
+typedef struct {
+    command_type_t type;
+    union {
+        struct {
+            float x, y, w, h; // @Note: same units as box.
+        } region;
+
+        struct {
+            float x, y, w, h;
+            u32 color;
+        } box;
+
+        struct {
+            float x, y;
+            float r;
+            u32 color;
+        } circle;
+
+        struct {
+            float x, y;
+            float r0, r1;
+            u32 color;
+        } disk;
+
+        struct {
+            float x, y;
+            const char* string; // @Note: not owned, has to outlive the frame. utf-8.
+            u32 color;
+            f32 size;           // pixel height at scale 1, 0 is DEFAULT_FONT_SIZE.
+        } text;
+    };
+
+} command_t;
+
+enum {
+    COMMAND_BUFFER_INITIAL_CAPACITY = 64,
+    DEFAULT_FONT_SIZE               = 32,
+};
+
+//
+// Commands live in an arena and the buffer doubles when it's full, in place when it's the last thing in the arena.
+//
+// @Note: if we are not rendering fast enough and the arena runs out, the pending commands are thrown away
+// and replaced by a single DRAW_EVERYTHING, which repaints whatever they would have.
+//
+typedef struct {
+    command_t* commands;
+    int32_t length;
+    int32_t capacity;
+
+    struct memory_arena_t* arena;
+} command_buffer_t;
+
+void command_buffer_init(command_buffer_t* buffer, struct memory_arena_t* arena);
+
+//
+// @Note: resets the arena too, the buffer has to be the only thing allocated from it.
+//
+void command_buffer_reset(command_buffer_t* buffer);
+
+void add_command(command_buffer_t* buffer, command_t cmd);
+
+
+//
+// width and height are the size of the surface, scale is how many buffer pixels there are per surface pixel.
+// World space covers the surface either way, only the buffer it's rasterized into changes with the scale.
+//
+void update_orthographic_projection(int32_t width, int32_t height, f32 scale);
+bool valid_orthographic_projection();
+f32  projection_scale();
+s32  scale_to_buffer(s32 size, f32 scale); // size of the buffer for a surface of size, rounded like wp_fractional_scale_v1 wants.
+
+void transform_screen_into_world(double* x, double* y); // from surface pixels, which is what input comes in.
+void transform_world_into_screen(float* x, float* y);   // into buffer pixels.
+
+uint32_t make_u32_from_color(color_t color);
+uint32_t make_u32_from_u8(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+rectangle_t intersect_rectangles(rectangle_t a, rectangle_t b);
+bool rectangle_is_empty(rectangle_t rect);
+rectangle_t buffer_rectangle(buffer_t* buffer);
+
+//
+// @Note: has to be called before command_bounds of a new frame, glyphs of the previous frame may get evicted after this.
+//
+void render_begin_frame();
+
+//
+// Text runs of the default font, for setting the budget and reading the stats.
+//
+struct text_run_cache_t* get_text_run_cache();
+
+//
+// Pixels that the command is going to touch, clipped to the buffer.
+// @Note: has to be called on every command before draw_command, text loads its font here.
+//
+rectangle_t command_bounds(buffer_t* buffer, const command_t* command);
+
+//
+// @Note: only pixels inside of clip are written, clip has to be inside of the buffer.
+// Drawing the same command with different clip rects gives the same pixels as drawing it once, so commands can be split into tiles.
+//
+void draw_command(buffer_t* buffer, const command_t* command, rectangle_t clip);
@@ -0,0 +1,139 @@
+#include "render_thread.h"
+#include "log.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+
+bool render_ring_push(render_ring_t* ring, render_job_t job) {
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == RENDER_RING_CAPACITY) {
+        return false;
+    }
+
+    ring->jobs[tail & (RENDER_RING_CAPACITY - 1)] = job;
+
+    // @Note: release, the consumer sees the job before it sees the new tail.
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool render_ring_pop(render_ring_t* ring, render_job_t* job) {
+    u32 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *job = ring->jobs[head & (RENDER_RING_CAPACITY - 1)];
+
+    // @Note: release, the producer doesn't reuse the job before we are done reading it.
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void signal_eventfd(int fd) {
+    u64 one = 1;
+    ssize_t ret;
+    do {
+        ret = write(fd, &one, sizeof(one));
+    } while (ret < 0 && errno == EINTR);
+}
+
+// Blocks on the render thread's wake_fd, returns immediately on done_fd which is non blocking.
+static void clear_eventfd(int fd) {
+    u64 count;
+    ssize_t ret;
+    do {
+        ret = read(fd, &count, sizeof(count));
+    } while (ret < 0 && errno == EINTR);
+}
+
+static void* render_main(void* data) {
+    render_thread_t* thread = data;
+
+    while (true) {
+        render_job_t job;
+        if (!render_ring_pop(&thread->submit, &job)) {
+            // @Note: jobs submitted before quit are still drawn, nothing waits on a frame that never comes back.
+            if (atomic_load(&thread->quit)) {
+                break;
+            }
+
+            clear_eventfd(thread->wake_fd);
+            thread->stats.wakeups += 1;
+            continue;
+        }
+
+        if (job.copy_forward) {
+            framebuffer_copy_forward(thread->framebuffers, job.buffer);
+        }
+        execute_frame(thread->tile_renderer, job.buffer, job.frame);
+
+        thread->stats.frames += 1;
+
+        bool pushed = render_ring_push(&thread->done, job);
+        assert(pushed); // @Note: there are never more jobs in flight than the ring holds.
+
+        signal_eventfd(thread->done_fd);
+    }
+
+    return NULL;
+}
+
+bool render_thread_init(render_thread_t* thread, tile_renderer_t* tile_renderer, framebuffer_manager_t* framebuffers) {
+    *thread = (render_thread_t) {
+        .tile_renderer = tile_renderer,
+        .framebuffers  = framebuffers,
+        .wake_fd       = -1,
+        .done_fd       = -1,
+    };
+
+    thread->wake_fd = eventfd(0, EFD_CLOEXEC);
+    thread->done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (thread->wake_fd < 0 || thread->done_fd < 0) {
+        log_error(LOG_RENDER, "Failed to create the eventfds of the render thread, errno %d.", errno);
+        render_thread_destroy(thread);
+        return false;
+    }
+
+    if (pthread_create(&thread->thread, NULL, render_main, thread) != 0) {
+        log_error(LOG_RENDER, "Failed to start the render thread.");
+        render_thread_destroy(thread);
+        return false;
+    }
+    thread->started = true;
+
+    return true;
+}
+
+void render_thread_destroy(render_thread_t* thread) {
+    if (thread->started) {
+        atomic_store(&thread->quit, true);
+        signal_eventfd(thread->wake_fd);
+        pthread_join(thread->thread, NULL);
+    }
+
+    if (thread->wake_fd >= 0) close(thread->wake_fd);
+    if (thread->done_fd >= 0) close(thread->done_fd);
+
+    thread->started = false;
+    thread->wake_fd = -1;
+    thread->done_fd = -1;
+}
+
+void render_thread_submit(render_thread_t* thread, render_job_t job) {
+    bool pushed = render_ring_push(&thread->submit, job);
+    assert(pushed);
+
+    signal_eventfd(thread->wake_fd);
+}
+
+bool render_thread_take_done(render_thread_t* thread, render_job_t* job) {
+    // @Note: cleared before popping, a frame pushed after this signals again and wakes up the next select.
+    clear_eventfd(thread->done_fd);
+    return render_ring_pop(&thread->done, job);
+}
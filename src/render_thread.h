@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+#include "frame.h"
+#include "tile_renderer.h"
+#include "framebuffer.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+//
+// Rasterizes frames off of the wayland thread, so that a slow repaint doesn't hold back input, configures and pings.
+//
+// The wayland thread builds a frame (build_frame only touches the ui, the caches and the pending commands) and pushes it
+// into the submit ring. The render thread copies the stale parts of the buffer forward, draws the frame with the tile
+// renderer and pushes it into the done ring, then signals done_fd. done_fd is an eventfd that goes into the select of
+// the main loop next to the display fd, the wayland thread attaches and commits whatever comes out of the done ring.
+//
+// Both rings are single producer, single consumer and lock free, the eventfds are only there to sleep on.
+//
+// @Note: while a frame is being drawn the wayland thread must not touch its buffer, its frame_t, the projection
+// or the framebuffers' stale regions. The client keeps one frame in flight, so it simply doesn't build, resize or present
+// until the frame comes back. The rings are bigger than that so that they never have to be checked for being full.
+//
+
+enum {
+    RENDER_RING_CAPACITY = 4, // @Note: power of two.
+};
+
+typedef struct {
+    frame_t*  frame;   // built, its commands are drawn into buffer.
+    buffer_t* buffer;
+    bool copy_forward; // bring the rest of the buffer up to date with the last presented frame first.
+
+    u64 profile_start; // when building the frame started, see PROFILE_EXECUTE.
+} render_job_t;
+
+typedef struct {
+    render_job_t jobs[RENDER_RING_CAPACITY];
+
+    // @Note: on their own cache lines, each of them is only written by one side.
+    alignas(64) atomic_uint head; // next job to pop, written by the consumer.
+    alignas(64) atomic_uint tail; // next free job, written by the producer.
+} render_ring_t;
+
+typedef struct {
+    u64 frames;
+    u64 wakeups; // times the render thread had to be woken up for a frame.
+} render_thread_stats_t;
+
+typedef struct {
+    pthread_t thread;
+    bool started;
+
+    tile_renderer_t* tile_renderer;
+    framebuffer_manager_t* framebuffers;
+
+    render_ring_t submit; // wayland thread -> render thread.
+    render_ring_t done;   // render thread -> wayland thread.
+
+    int wake_fd; // the render thread sleeps on it while submit is empty.
+    int done_fd; // readable while done has jobs, goes into the select of the main loop.
+
+    atomic_bool quit;
+
+    render_thread_stats_t stats;
+} render_thread_t;
+
+bool render_ring_push(render_ring_t* ring, render_job_t job);
+bool render_ring_pop(render_ring_t* ring, render_job_t* job);
+
+bool render_thread_init(render_thread_t* thread, tile_renderer_t* tile_renderer, framebuffer_manager_t* framebuffers);
+void render_thread_destroy(render_thread_t* thread);
+
+//
+// Hands a built frame to the render thread, called from the wayland thread only.
+//
+void render_thread_submit(render_thread_t* thread, render_job_t job);
+
+//
+// Next drawn frame, false when there is none. Clears done_fd, so call it until it returns false once done_fd is readable.
+//
+bool render_thread_take_done(render_thread_t* thread, render_job_t* job);
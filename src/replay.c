@@ -0,0 +1,811 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define REPLAY_X86 1
+#endif
+
+#include "types.h"
+#include "base.h"
+#include "print.h"
+#include "temporary_storage.h"
+#include "render.h"
+#include "span_fill.h"
+#include "tile_renderer.h"
+#include "frame.h"
+#include "headless.h"
+#include "text_run_cache.h"
+#include "texture.h"
+#include "blend.h"
+#include "ui.h"
+#include "layout.h"
+#include "pool.h"
+
+//
+// Replays recorded command streams into an offscreen buffer.
+//
+// Every scene is rendered through the same build_frame/execute_frame path as the wayland client,
+// the result is compared byte for byte against <scene dir>/golden/<scene name>.png and the frame times are reported.
+// Scenes without a golden image are only timed, they don't count as failed.
+//
+// Scene format, one command per line, '#' starts a comment:
+//     size W H
+//     everything
+//     region x y w h                # redraws the layout inside of the rect.
+//     hover  x y                    # moves the pointer before the frame is built, hovered tabs of the layout redraw themselves.
+//     box    x y w h color
+//     circle x y r color
+//     disk   x y r0 r1 color
+//     text   x y color "string" [size]
+//     frame                         # ends the current frame, lines after it go into the next one.
+//     check-redraw                  # the frames have to end up with the same pixels as one 'everything' of the final state,
+//                                   # checks the partial redraws of scenes that can't have a golden image.
+//
+// Coordinates are in world units (see update_orthographic_projection), colors are 0xAARRGGBB.
+//
+
+enum {
+    MAX_SCENE_FRAMES   = 256,
+    DEFAULT_ITERATIONS = 100,
+    SCENE_ARENA_SIZE   = 16 * 1024 * 1024,
+};
+
+typedef struct {
+    s32 width;
+    s32 height;
+
+    command_buffer_t frames[MAX_SCENE_FRAMES];
+    s32 frame_count;
+
+    bool has_hover[MAX_SCENE_FRAMES];
+    f32  hover[MAX_SCENE_FRAMES][2];
+
+    bool check_redraw;
+
+    memory_arena_t arena; // commands of all of the frames.
+} scene_t;
+
+typedef struct {
+    bool update;
+    s32  iterations;
+    s32  threads;
+    s64  text_budget; // -1 keeps the default.
+    s32  damage_rects;
+    bool no_occlusion;
+    const char* output; // where mismatching images go, NULL doesn't write them.
+} options_t;
+
+
+static u64 get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+// Cycles where there is a cycle counter, nanoseconds elsewhere. TICK_UNIT names which one it is.
+#ifdef REPLAY_X86
+#define TICK_UNIT "cycles"
+static u64 get_ticks() { return __rdtsc(); }
+#else
+#define TICK_UNIT "ns"
+static u64 get_ticks() { return get_time_ns(); }
+#endif
+
+static char* read_entire_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* data = malloc(size + 1);
+    size_t read = fread(data, 1, size, file);
+    data[read] = '\0';
+
+    fclose(file);
+    return data;
+}
+
+static bool parse_scene_line(scene_t* scene, char* line, s32 line_number, const char* path) {
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+
+    char name[16];
+    int  consumed = 0;
+    if (sscanf(line, " %15s%n", name, &consumed) != 1) {
+        return true; // empty line.
+    }
+
+    char* args = line + consumed;
+    command_buffer_t* commands = &scene->frames[scene->frame_count];
+
+    command_t command = {};
+    bool ok = false;
+
+    if (strcmp(name, "size") == 0) {
+        ok = sscanf(args, "%d %d", &scene->width, &scene->height) == 2 && scene->width > 0 && scene->height > 0;
+        if (ok) return true;
+    }
+    else if (strcmp(name, "frame") == 0) {
+        if (scene->frame_count + 1 == MAX_SCENE_FRAMES) {
+            print("%s:%d: scene has more than %d frames.", path, line_number, MAX_SCENE_FRAMES);
+            return false;
+        }
+        scene->frame_count += 1;
+        return true;
+    }
+    else if (strcmp(name, "check-redraw") == 0) {
+        scene->check_redraw = true;
+        return true;
+    }
+    else if (strcmp(name, "everything") == 0) {
+        command.type = COMMAND_TYPE_DRAW_EVERYTHING;
+        ok = true;
+    }
+    else if (strcmp(name, "hover") == 0) {
+        f32* hover = scene->hover[scene->frame_count];
+        ok = sscanf(args, "%f %f", &hover[0], &hover[1]) == 2;
+
+        scene->has_hover[scene->frame_count] = ok;
+        if (ok) return true;
+    }
+    else if (strcmp(name, "region") == 0) {
+        command.type = COMMAND_TYPE_DRAW_REGION;
+        ok = sscanf(args, "%f %f %f %f", &command.region.x, &command.region.y, &command.region.w, &command.region.h) == 4;
+    }
+    else if (strcmp(name, "box") == 0) {
+        command.type = COMMAND_TYPE_DRAW_BOX;
+        ok = sscanf(args, "%f %f %f %f %x", &command.box.x, &command.box.y, &command.box.w, &command.box.h, &command.box.color) == 5;
+    }
+    else if (strcmp(name, "circle") == 0) {
+        command.type = COMMAND_TYPE_DRAW_CIRCLE;
+        ok = sscanf(args, "%f %f %f %x", &command.circle.x, &command.circle.y, &command.circle.r, &command.circle.color) == 4;
+    }
+    else if (strcmp(name, "disk") == 0) {
+        command.type = COMMAND_TYPE_DRAW_DISK;
+        ok = sscanf(args, "%f %f %f %f %x", &command.disk.x, &command.disk.y, &command.disk.r0, &command.disk.r1, &command.disk.color) == 5;
+    }
+    else if (strcmp(name, "text") == 0) {
+        command.type = COMMAND_TYPE_DRAW_TEXT;
+
+        char* first = strchr(args, '"');
+        char* last  = first ? strrchr(first + 1, '"') : NULL;
+
+        ok = first && last && sscanf(args, "%f %f %x", &command.text.x, &command.text.y, &command.text.color) == 3;
+        if (ok) {
+            command.text.string = strndup(first + 1, last - first - 1); // @Note: lives as long as the scene, which is the whole run.
+            sscanf(last + 1, "%f", &command.text.size);
+        }
+    }
+    else {
+        print("%s:%d: unknown command '%s'.", path, line_number, name);
+        return false;
+    }
+
+    if (!ok) {
+        print("%s:%d: couldn't parse arguments of '%s'.", path, line_number, name);
+        return false;
+    }
+
+    add_command(commands, command);
+    return true;
+}
+
+static bool load_scene(scene_t* scene, const char* path) {
+    char* data = read_entire_file(path);
+    if (!data) {
+        print("Couldn't open scene '%s'.", path);
+        return false;
+    }
+
+    if (scene->arena.data == NULL) {
+        arena_init(&scene->arena, SCENE_ARENA_SIZE);
+    }
+
+    memory_arena_t arena = scene->arena;
+    arena_reset(&arena);
+
+    *scene = (scene_t) { .width = 1280, .height = 720, .arena = arena };
+    for (s32 f = 0; f < MAX_SCENE_FRAMES; f++) {
+        command_buffer_init(&scene->frames[f], &scene->arena);
+    }
+
+    bool ok = true;
+    s32 line_number = 1;
+    for (char* line = data; line && ok; line_number++) {
+        char* next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+
+        ok   = parse_scene_line(scene, line, line_number, path);
+        line = next;
+    }
+
+    // The last frame doesn't need a trailing 'frame'.
+    if (scene->frames[scene->frame_count].length > 0 || scene->has_hover[scene->frame_count]) {
+        scene->frame_count += 1;
+    }
+
+    free(data);
+    return ok;
+}
+
+// "dir/name.scene" -> "dir", "name".
+static void split_scene_path(const char* path, literal* directory, literal* name) {
+    const char* slash = strrchr(path, '/');
+    const char* base  = slash ? slash + 1 : path;
+    const char* dot   = strrchr(base, '.');
+
+    *directory = slash ? (literal) { path, (size_t) (slash - path) } : lit(".");
+    *name      = (literal) { base, dot ? (size_t) (dot - base) : strlen(base) };
+}
+
+typedef enum {
+    GOLDEN_MATCH = 0,
+    GOLDEN_MISMATCH,
+    GOLDEN_MISSING, // the scene is only timed, see the scenes that draw text.
+} golden_result_t;
+
+static golden_result_t compare_with_golden(const char* path, const u8* png, s32 size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return GOLDEN_MISSING;
+    }
+
+    u8* golden = malloc(size + 1);
+    size_t read = fread(golden, 1, size + 1, file);
+    fclose(file);
+
+    bool same = read == (size_t) size && memcmp(golden, png, size) == 0;
+    free(golden);
+    return same ? GOLDEN_MATCH : GOLDEN_MISMATCH;
+}
+
+static ui_t ui; // the layout, same as the wayland client.
+
+static void build_scene_frame(frame_t* frame, buffer_t* buffer, const scene_t* scene, s32 f, const options_t* options) {
+    if (scene->has_hover[f]) {
+        ui_update_hover(&ui, scene->hover[f][0], scene->hover[f][1]);
+    }
+
+    build_frame(frame, buffer, &scene->frames[f], options->damage_rects);
+}
+
+//
+// Draws the layout in its current state from scratch and compares it with what the frames drew into buffer.
+// @Note: the scene has to draw nothing but the layout, anything else shows up as a difference.
+//
+static bool check_full_redraw(tile_renderer_t* renderer, frame_t* frame, const buffer_t* buffer, scene_t* scene, const options_t* options) {
+    buffer_t reference = allocate_headless_buffer(buffer->width, buffer->height);
+    memset(reference.data, 0, (size_t) reference.width * reference.height * sizeof(u32));
+
+    command_buffer_t everything;
+    command_buffer_init(&everything, &scene->arena);
+    add_command(&everything, (command_t) { .type = COMMAND_TYPE_DRAW_EVERYTHING });
+
+    build_frame(frame, &reference, &everything, options->damage_rects);
+    execute_frame(renderer, &reference, frame);
+
+    bool same = memcmp(reference.data, buffer->data, (size_t) buffer->width * buffer->height * sizeof(u32)) == 0;
+    free_headless_buffer(&reference);
+    return same;
+}
+
+static void report_primitive_timings(frame_t* frame, buffer_t* buffer, const scene_t* scene, const options_t* options) {
+    s32 iterations = options->iterations;
+
+    static const char* names[] = {
+        [COMMAND_TYPE_DRAW_BOX]    = "box",
+        [COMMAND_TYPE_DRAW_CIRCLE] = "circle",
+        [COMMAND_TYPE_DRAW_DISK]   = "disk",
+        [COMMAND_TYPE_DRAW_TEXT]   = "text",
+    };
+
+    u64 ns[static_array_size(names)]     = {};
+    u64 pixels[static_array_size(names)] = {};
+    s32 count[static_array_size(names)]  = {};
+
+    for (s32 f = 0; f < scene->frame_count; f++) {
+        build_scene_frame(frame, buffer, scene, f, options);
+
+        for (s32 i = 0; i < frame->commands.length; i++) {
+            const command_t* command = &frame->commands.commands[i];
+            rectangle_t bounds = frame->bounds[i];
+            if (rectangle_is_empty(bounds)) continue;
+
+            u64 start = get_time_ns();
+            for (s32 n = 0; n < iterations; n++) {
+                draw_command(buffer, command, bounds);
+            }
+            u64 elapsed = get_time_ns() - start;
+
+            ns[command->type]     += elapsed;
+            pixels[command->type] += (u64) bounds.w * bounds.h * iterations;
+            count[command->type]  += 1;
+        }
+    }
+
+    for (u32 type = 0; type < static_array_size(names); type++) {
+        if (count[type] == 0) continue;
+
+        print("    %-8s x%-4d %8.3f us/draw  %6.3f ns/px",
+              names[type], count[type],
+              (f64) ns[type] / ((f64) count[type] * iterations) / 1000.0,
+              (f64) ns[type] / (f64) pixels[type]);
+    }
+}
+
+static void accumulate_frame_stats(frame_stats_t* total, frame_stats_t* peak, const frame_stats_t* stats) {
+    total->pending         += stats->pending;
+    total->merged          += stats->merged;
+    total->culled          += stats->culled;
+    total->drawn           += stats->drawn;
+    total->batches         += stats->batches;
+    total->pixels          += stats->pixels;
+    total->occluded_pixels += stats->occluded_pixels;
+
+    peak->pending = max(peak->pending, stats->pending);
+    peak->drawn   = max(peak->drawn,   stats->drawn);
+}
+
+static bool replay_scene(tile_renderer_t* renderer, const char* path, const options_t* options) {
+    static scene_t scene; // @Note: too big for the stack.
+
+    if (!load_scene(&scene, path)) {
+        return false;
+    }
+
+    buffer_t buffer = allocate_headless_buffer(scene.width, scene.height);
+    if (!buffer.data) {
+        print("Couldn't allocate %dx%d buffer for '%s'.", scene.width, scene.height, path);
+        return false;
+    }
+
+    update_orthographic_projection(scene.width, scene.height, 1.0f);
+
+    static frame_t frame;
+    if (frame.arena.data == NULL) {
+        frame_init(&frame, FRAME_ARENA_SIZE, &ui);
+    }
+    frame.occlusion = !options->no_occlusion;
+
+    // @Note: scenes draw only what they say, the layout shows up with 'everything' or 'region'.
+    ui_update_hover(&ui, -1.0f, -1.0f);
+    ui_clear_dirty(&ui);
+
+    // Reference render, everything that frames don't redraw is black.
+    u64 damaged_pixels = 0;
+    s32 damage_rects   = 0;
+
+    frame_stats_t total_commands = {};
+    frame_stats_t peak_commands  = {};
+
+    memset(buffer.data, 0, (size_t) buffer.width * buffer.height * sizeof(u32));
+    for (s32 f = 0; f < scene.frame_count; f++) {
+        build_scene_frame(&frame, &buffer, &scene, f, options);
+        execute_frame(renderer, &buffer, &frame);
+
+        damaged_pixels += region_area(&frame.damage);
+        damage_rects   += frame.damage.count;
+
+        accumulate_frame_stats(&total_commands, &peak_commands, &frame.stats);
+    }
+
+    s32 png_size = 0;
+    u8* png = encode_buffer_png(&buffer, &png_size);
+
+    literal directory, name;
+    split_scene_path(path, &directory, &name);
+
+    const char* golden_path = tprint("%.*s/golden/%.*s.png", fmt(directory), fmt(name)).data;
+    golden_result_t golden = compare_with_golden(golden_path, png, png_size);
+
+    if (options->update) {
+        golden = write_buffer_png(&buffer, golden_path) ? GOLDEN_MATCH : GOLDEN_MISMATCH;
+        print("%.*s: golden image written to '%s'.", fmt(name), golden_path);
+    }
+    else if (golden == GOLDEN_MISMATCH) {
+        // @Note: only written when asked for, so that running from the source tree doesn't leave images in it.
+        if (options->output) {
+            const char* output_path = tprint("%s/%.*s.png", options->output, fmt(name)).data;
+            write_buffer_png(&buffer, output_path);
+            print("%.*s: MISMATCH against '%s', got '%s'.", fmt(name), golden_path, output_path);
+        } else {
+            print("%.*s: MISMATCH against '%s', pass --output DIR to keep the image.", fmt(name), golden_path);
+        }
+    }
+    free(png);
+
+    // @Note: after the golden image is done with the buffer, the full redraw goes into its own buffer and leaves it alone.
+    bool redraw_matches = true;
+    if (scene.check_redraw) {
+        redraw_matches = check_full_redraw(renderer, &frame, &buffer, &scene, options);
+        if (!redraw_matches) {
+            print("%.*s: MISMATCH between the frames and a full redraw of the layout.", fmt(name));
+        }
+    }
+    bool passed = golden != GOLDEN_MISMATCH && redraw_matches;
+
+    const char* status = !passed                   ? "FAILED"
+                       : golden == GOLDEN_MATCH    ? "ok"
+                       : scene.check_redraw        ? "no golden, redraw checked"
+                       :                             "no golden, timing only";
+
+    // Frame timings.
+    u64 total = 0;
+    u64 best  = UINT64_MAX;
+    for (s32 n = 0; n < options->iterations; n++) {
+        u64 start = get_time_ns();
+        for (s32 f = 0; f < scene.frame_count; f++) {
+            build_scene_frame(&frame, &buffer, &scene, f, options);
+            execute_frame(renderer, &buffer, &frame);
+        }
+        u64 elapsed = get_time_ns() - start;
+
+        total += elapsed;
+        best   = min(best, elapsed);
+    }
+
+    f64 frames = (f64) scene.frame_count;
+    print("%.*s: %dx%d, %d frames, %s, avg %.3f ms/frame, min %.3f ms/frame (%d threads)",
+          fmt(name), scene.width, scene.height, scene.frame_count,
+          status,
+          (f64) total / (frames * options->iterations) / 1e6,
+          (f64) best / frames / 1e6,
+          renderer->thread_count + 1);
+
+    print("    damage: %.1f rects/frame, %.1f%% of the buffer per frame",
+          damage_rects / frames,
+          100.0 * (f64) damaged_pixels / (frames * buffer.width * buffer.height));
+
+    print("    commands: avg %.1f pending, %.1f merged, %.1f culled, %.1f drawn in %.1f batches per frame",
+          total_commands.pending / frames, total_commands.merged / frames, total_commands.culled / frames,
+          total_commands.drawn / frames, total_commands.batches / frames);
+    print("              peak %d pending, %d drawn", peak_commands.pending, peak_commands.drawn);
+    print("    pixels: avg %.0f written per frame, %.2fx the damage, %.0f occluded",
+          (f64) total_commands.pixels / frames,
+          damaged_pixels ? (f64) total_commands.pixels / (f64) damaged_pixels : 0.0,
+          (f64) total_commands.occluded_pixels / frames);
+
+    report_primitive_timings(&frame, &buffer, &scene, options);
+
+    text_run_stats_t* stats = &get_text_run_cache()->stats;
+    if (stats->hits + stats->misses > 0) {
+        print("    text runs: %llu hits, %llu misses, %llu evictions, %llu rejected, %llu runs in %llu bytes",
+              stats->hits, stats->misses, stats->evictions, stats->rejected, stats->runs, stats->bytes);
+    }
+    *stats = (text_run_stats_t) { .runs = stats->runs, .bytes = stats->bytes };
+
+    free_headless_buffer(&buffer);
+    return passed;
+}
+
+//
+// Cycles (ns without a cycle counter) per pixel of the dispatched span fill against the plain loop, for a couple of span sizes.
+//
+static void bench_fill() {
+    static const u32 sizes[] = { 16, 64, 256, 1024, 4096, 1920 * 1080 };
+    enum { TOTAL_PIXELS = 64 * 1024 * 1024 };
+
+    u32* data = aligned_alloc(64, sizes[static_array_size(sizes) - 1] * sizeof(u32));
+
+    for (u32 i = 0; i < static_array_size(sizes); i++) {
+        u32 count  = sizes[i];
+        u32 rounds = max(TOTAL_PIXELS / count, 1u);
+
+        u64 start = get_ticks();
+        for (u32 n = 0; n < rounds; n++) fill_span_scalar(data, n, count);
+        u64 scalar = get_ticks() - start;
+
+        start = get_ticks();
+        for (u32 n = 0; n < rounds; n++) fill_span(data, n, count);
+        u64 simd = get_ticks() - start;
+
+        f64 pixels = (f64) count * rounds;
+        print("fill %8u px: scalar %6.3f " TICK_UNIT "/px, fill_span %6.3f " TICK_UNIT "/px",
+              count, (f64) scalar / pixels, (f64) simd / pixels);
+    }
+
+    free(data);
+}
+
+//
+// @Note: the float loop that draw_textured_quad replaced, two divides per pixel, kept here to measure against.
+//
+static void draw_textured_quad_float(buffer_t* buffer, const texture_t* texture, textured_quad_t q, u32 color, rectangle_t clip) {
+    f32 w = q.x1 - q.x0;
+    f32 h = q.y1 - q.y0;
+
+    s32 x_first = max((s32) q.x0, clip.x);
+    s32 x_last  = min((s32) q.x1 - 1, clip.x + clip.w - 1);
+    s32 y_first = max((s32) q.y0, clip.y);
+    s32 y_end   = min((s32) q.y1, clip.y + clip.h);
+
+    for (s32 y = y_first; y < y_end; y++) {
+        f32 v = q.v0 + (y - q.y0) * (q.v1 - q.v0) / h;
+
+        u8 coverage[256];
+        for (s32 chunk = x_first; chunk <= x_last; chunk += (s32) static_array_size(coverage)) {
+            s32 count = min(x_last - chunk + 1, (s32) static_array_size(coverage));
+
+            for (s32 i = 0; i < count; i++) {
+                f32 u = q.u0 + (chunk + i - q.x0) * (q.u1 - q.u0) / w;
+                coverage[i] = texture->data[(s32) (u*texture->width + texture->width * v * texture->height)];
+            }
+
+            blend_span_coverage(buffer->data + (y * buffer->width + chunk), color, coverage, (u32) count);
+        }
+    }
+}
+
+//
+// Nanoseconds per pixel of glyph sized quads, 1:1 and scaled, drawn with draw_textured_quad and with the old float loop.
+//
+static void bench_blit() {
+    enum { TEXTURE_SIZE = 512, ROUNDS = 20000 };
+
+    texture_t texture = {
+        .data   = malloc(TEXTURE_SIZE * TEXTURE_SIZE),
+        .width  = TEXTURE_SIZE,
+        .height = TEXTURE_SIZE,
+        .stride = TEXTURE_SIZE,
+        .format = TEXTURE_FORMAT_A8,
+    };
+    for (s32 i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; i++) {
+        texture.data[i] = (u8) (i * 2654435761u >> 24);
+    }
+
+    buffer_t buffer = allocate_headless_buffer(1280, 720);
+    rectangle_t clip = buffer_rectangle(&buffer);
+
+    static const struct { const char* name; f32 scale; } cases[] = {
+        { "1:1",   1.0f },
+        { "x1.5",  1.5f },
+        { "x0.75", 0.75f },
+    };
+
+    for (u32 c = 0; c < static_array_size(cases); c++) {
+        f32 size = 32.0f * cases[c].scale;
+
+        u64 elapsed[2] = {};
+        for (s32 variant = 0; variant < 2; variant++) {
+            u64 start = get_time_ns();
+
+            for (s32 n = 0; n < ROUNDS; n++) {
+                f32 x = (f32) ((n * 37) % 1200);
+                f32 y = (f32) ((n * 53) % 640);
+                f32 u = (f32) ((n * 32) % (TEXTURE_SIZE - 32)) / TEXTURE_SIZE;
+
+                textured_quad_t quad = {
+                    .x0 = x, .y0 = y, .x1 = x + size, .y1 = y + size,
+                    .u0 = u, .v0 = u, .u1 = u + 32.0f / TEXTURE_SIZE, .v1 = u + 32.0f / TEXTURE_SIZE,
+                };
+
+                if (variant == 0) draw_textured_quad(&buffer, &texture, quad, 0xffffffff, clip);
+                else              draw_textured_quad_float(&buffer, &texture, quad, 0xffffffff, clip);
+            }
+
+            elapsed[variant] = get_time_ns() - start;
+        }
+
+        f64 pixels = (f64) size * size * ROUNDS;
+        print("blit %-5s: draw_textured_quad %6.3f ns/px, float loop %6.3f ns/px",
+              cases[c].name, (f64) elapsed[0] / pixels, (f64) elapsed[1] / pixels);
+    }
+
+    free_headless_buffer(&buffer);
+    free(texture.data);
+}
+
+//
+// Nanoseconds per release + allocate and per object of an update pass, with live records churning the way
+// breakpoints and ui nodes do: a batch of them is thrown away and remade, then all of them are walked.
+// The pool against malloc/free with an array of pointers.
+//
+typedef struct {
+    u64 address;
+    u32 line;
+    u32 hits;
+    f32 rect[4];
+    u8  pad[32];
+} bench_record_t;
+
+// One victim in every LIVE / UPDATE_EVERY records, so that none of them is released twice.
+static void pick_victims(u32* random, u32* victims, u32 count, u32 live) {
+    u32 stride = live / count;
+    for (u32 i = 0; i < count; i++) {
+        *random = *random * 1664525u + 1013904223u;
+        victims[i] = i * stride + (*random >> 8) % stride;
+    }
+}
+
+static void bench_pool() {
+    enum { LIVE = 4096, ROUNDS = 1 << 22, UPDATE_EVERY = 64 };
+
+    u64 passes = ROUNDS / UPDATE_EVERY;
+    u64 checksum[2] = {};
+    u32 victims[UPDATE_EVERY];
+
+    // @Note: the same sequence of victims for both.
+    u32 random = 0x12345678;
+
+    pool_t pool;
+    pool_init_typed(&pool, bench_record_t);
+    pool_handle_t* handles = malloc(LIVE * sizeof(pool_handle_t));
+
+    for (u32 i = 0; i < LIVE; i++) {
+        pool_alloc_typed(&pool, bench_record_t, &handles[i])->line = i;
+    }
+
+    u64 churn_time[2]  = {};
+    u64 update_time[2] = {};
+
+    for (u64 n = 0; n < passes; n++) {
+        pick_victims(&random, victims, UPDATE_EVERY, LIVE);
+
+        u64 start = get_time_ns();
+        for (u32 r = 0; r < UPDATE_EVERY; r++) {
+            pool_release(&pool, handles[victims[r]]);
+        }
+        for (u32 r = 0; r < UPDATE_EVERY; r++) {
+            pool_alloc_typed(&pool, bench_record_t, &handles[victims[r]])->line = victims[r];
+        }
+        u64 middle = get_time_ns();
+
+        bench_record_t* records = pool_items_typed(&pool, bench_record_t);
+        u32 count = pool.count;
+        u64 sum   = 0;
+        for (u32 i = 0; i < count; i++) {
+            records[i].hits += 1;
+            sum             += records[i].line;
+        }
+        checksum[0] += sum;
+        u64 end = get_time_ns();
+
+        churn_time[0]  += middle - start;
+        update_time[0] += end - middle;
+    }
+
+    random = 0x12345678;
+
+    bench_record_t** pointers = malloc(LIVE * sizeof(bench_record_t*));
+    for (u32 i = 0; i < LIVE; i++) {
+        pointers[i] = calloc(1, sizeof(bench_record_t));
+        pointers[i]->line = i;
+    }
+
+    for (u64 n = 0; n < passes; n++) {
+        pick_victims(&random, victims, UPDATE_EVERY, LIVE);
+
+        u64 start = get_time_ns();
+        for (u32 r = 0; r < UPDATE_EVERY; r++) {
+            free(pointers[victims[r]]);
+        }
+        for (u32 r = 0; r < UPDATE_EVERY; r++) {
+            pointers[victims[r]] = calloc(1, sizeof(bench_record_t));
+            pointers[victims[r]]->line = victims[r];
+        }
+        u64 middle = get_time_ns();
+
+        u64 sum = 0;
+        for (u32 i = 0; i < LIVE; i++) {
+            pointers[i]->hits += 1;
+            sum               += pointers[i]->line;
+        }
+        checksum[1] += sum;
+        u64 end = get_time_ns();
+
+        churn_time[1]  += middle - start;
+        update_time[1] += end - middle;
+    }
+
+    assert(checksum[0] == checksum[1] && pool.stats.stale == 0);
+
+    static const char* names[] = { "pool", "malloc" };
+    for (u32 i = 0; i < 2; i++) {
+        print("%-6s: churn %6.2f ns/object, update %6.3f ns/object",
+              names[i], (f64) churn_time[i] / ROUNDS, (f64) update_time[i] / ((f64) passes * LIVE));
+    }
+
+    for (u32 i = 0; i < LIVE; i++) free(pointers[i]);
+    free(pointers);
+    free(handles);
+    pool_destroy(&pool);
+}
+
+static void usage() {
+    print("usage: replay [--update] [--iterations N] [--threads N] [--text-budget BYTES] [--damage-rects N] [--no-occlusion] [--output DIR] scene...");
+    print("       replay --bench-fill");
+    print("       replay --bench-blit");
+    print("       replay --bench-pool");
+}
+
+int main(int argc, char** argv) {
+    options_t options = {
+        .iterations   = DEFAULT_ITERATIONS,
+        .text_budget  = -1,
+        .damage_rects = REGION_DEFAULT_RECT_BUDGET,
+    };
+
+    s32 first_scene = argc;
+    for (s32 i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+
+        if (strcmp(arg, "--update") == 0) {
+            options.update = true;
+        }
+        else if (strcmp(arg, "--iterations") == 0 && i + 1 < argc) {
+            s32 iterations = atoi(argv[++i]);
+            options.iterations = max(iterations, 1);
+        }
+        else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "--text-budget") == 0 && i + 1 < argc) {
+            options.text_budget = atoll(argv[++i]);
+        }
+        else if (strcmp(arg, "--damage-rects") == 0 && i + 1 < argc) {
+            s32 rects = atoi(argv[++i]);
+            options.damage_rects = clamp(rects, 1, (s32) MAX_REGION_RECTS);
+        }
+        else if (strcmp(arg, "--no-occlusion") == 0) {
+            options.no_occlusion = true;
+        }
+        else if (strcmp(arg, "--output") == 0 && i + 1 < argc) {
+            options.output = argv[++i];
+        }
+        else if (strcmp(arg, "--bench-fill") == 0) {
+            bench_fill();
+            return 0;
+        }
+        else if (strcmp(arg, "--bench-blit") == 0) {
+            bench_blit();
+            return 0;
+        }
+        else if (strcmp(arg, "--bench-pool") == 0) {
+            bench_pool();
+            return 0;
+        }
+        else if (arg[0] == '-') {
+            usage();
+            return 2;
+        }
+        else {
+            first_scene = i;
+            break;
+        }
+    }
+
+    if (first_scene == argc) {
+        usage();
+        return 2;
+    }
+
+    if (options.text_budget >= 0) {
+        text_run_cache_set_budget(get_text_run_cache(), (u64) options.text_budget);
+    }
+
+    tile_renderer_t renderer;
+    tile_renderer_init(&renderer, options.threads);
+
+    ui_init(&ui);
+    build_layout(&ui);
+
+    s32 failed = 0;
+    for (s32 i = first_scene; i < argc; i++) {
+        if (!replay_scene(&renderer, argv[i], &options)) {
+            failed += 1;
+        }
+        temporary_reset();
+    }
+
+    tile_renderer_destroy(&renderer);
+    return failed == 0 ? 0 : 1;
+}
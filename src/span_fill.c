@@ -0,0 +1,231 @@
+#include "span_fill.h"
+#include "cpu.h"
+
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPAN_FILL_X86 1
+#endif
+
+
+typedef struct {
+    void (*fill)(u32* data, u32 value, u32 count);
+    void (*stream)(u32* data, u32 value, u32 count); // non-temporal stores, needs a fence afterwards.
+    void (*fence)();
+} span_fill_impl_t;
+
+
+void fill_span_scalar(u32* data, u32 value, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        data[i] = value;
+    }
+}
+
+static void fence_none() {
+}
+
+#ifdef SPAN_FILL_X86
+
+//
+// @Note: every variant fills the unaligned head with scalar stores first, so that the vector loop can use aligned (and streaming) stores.
+//
+
+#define FILL_HEAD(alignment)                                                  \
+    while (i < count && ((uintptr_t) (data + i) & ((alignment) - 1)) != 0) { \
+        data[i++] = value;                                                    \
+    }
+
+#define FILL_TAIL()            \
+    for (; i < count; i++) {   \
+        data[i] = value;       \
+    }
+
+__attribute__((target("sse2")))
+static void fill_span_sse2(u32* data, u32 value, u32 count) {
+    u32 i = 0;
+    FILL_HEAD(16);
+
+    __m128i v = _mm_set1_epi32((int) value);
+    for (; i + 16 <= count; i += 16) {
+        _mm_store_si128((__m128i*) (data + i +  0), v);
+        _mm_store_si128((__m128i*) (data + i +  4), v);
+        _mm_store_si128((__m128i*) (data + i +  8), v);
+        _mm_store_si128((__m128i*) (data + i + 12), v);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_store_si128((__m128i*) (data + i), v);
+    }
+
+    FILL_TAIL();
+}
+
+__attribute__((target("sse2")))
+static void stream_span_sse2(u32* data, u32 value, u32 count) {
+    u32 i = 0;
+    FILL_HEAD(16);
+
+    __m128i v = _mm_set1_epi32((int) value);
+    for (; i + 16 <= count; i += 16) {
+        _mm_stream_si128((__m128i*) (data + i +  0), v);
+        _mm_stream_si128((__m128i*) (data + i +  4), v);
+        _mm_stream_si128((__m128i*) (data + i +  8), v);
+        _mm_stream_si128((__m128i*) (data + i + 12), v);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_stream_si128((__m128i*) (data + i), v);
+    }
+
+    FILL_TAIL();
+}
+
+__attribute__((target("avx2")))
+static void fill_span_avx2(u32* data, u32 value, u32 count) {
+    u32 i = 0;
+    FILL_HEAD(32);
+
+    __m256i v = _mm256_set1_epi32((int) value);
+    for (; i + 32 <= count; i += 32) {
+        _mm256_store_si256((__m256i*) (data + i +  0), v);
+        _mm256_store_si256((__m256i*) (data + i +  8), v);
+        _mm256_store_si256((__m256i*) (data + i + 16), v);
+        _mm256_store_si256((__m256i*) (data + i + 24), v);
+    }
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_store_si256((__m256i*) (data + i), v);
+    }
+
+    FILL_TAIL();
+}
+
+__attribute__((target("avx2")))
+static void stream_span_avx2(u32* data, u32 value, u32 count) {
+    u32 i = 0;
+    FILL_HEAD(32);
+
+    __m256i v = _mm256_set1_epi32((int) value);
+    for (; i + 32 <= count; i += 32) {
+        _mm256_stream_si256((__m256i*) (data + i +  0), v);
+        _mm256_stream_si256((__m256i*) (data + i +  8), v);
+        _mm256_stream_si256((__m256i*) (data + i + 16), v);
+        _mm256_stream_si256((__m256i*) (data + i + 24), v);
+    }
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_stream_si256((__m256i*) (data + i), v);
+    }
+
+    FILL_TAIL();
+}
+
+__attribute__((target("avx512f")))
+static void fill_span_avx512(u32* data, u32 value, u32 count) {
+    u32 i = 0;
+    FILL_HEAD(64);
+
+    __m512i v = _mm512_set1_epi32((int) value);
+    for (; i + 64 <= count; i += 64) {
+        _mm512_store_si512((void*) (data + i +  0), v);
+        _mm512_store_si512((void*) (data + i + 16), v);
+        _mm512_store_si512((void*) (data + i + 32), v);
+        _mm512_store_si512((void*) (data + i + 48), v);
+    }
+
+    for (; i + 16 <= count; i += 16) {
+        _mm512_store_si512((void*) (data + i), v);
+    }
+
+    FILL_TAIL();
+}
+
+__attribute__((target("avx512f")))
+static void stream_span_avx512(u32* data, u32 value, u32 count) {
+    u32 i = 0;
+    FILL_HEAD(64);
+
+    __m512i v = _mm512_set1_epi32((int) value);
+    for (; i + 64 <= count; i += 64) {
+        _mm512_stream_si512((void*) (data + i +  0), v);
+        _mm512_stream_si512((void*) (data + i + 16), v);
+        _mm512_stream_si512((void*) (data + i + 32), v);
+        _mm512_stream_si512((void*) (data + i + 48), v);
+    }
+
+    for (; i + 16 <= count; i += 16) {
+        _mm512_stream_si512((void*) (data + i), v);
+    }
+
+    FILL_TAIL();
+}
+
+#undef FILL_HEAD
+#undef FILL_TAIL
+
+__attribute__((target("sse2")))
+static void fence_sse2() {
+    _mm_sfence();
+}
+
+#endif // SPAN_FILL_X86
+
+
+static span_fill_impl_t span_fill_impl;
+static pthread_once_t span_fill_once = PTHREAD_ONCE_INIT;
+
+static void select_span_fill_impl() {
+    span_fill_impl = (span_fill_impl_t) {
+        .fill   = fill_span_scalar,
+        .stream = fill_span_scalar,
+        .fence  = fence_none,
+    };
+
+#ifdef SPAN_FILL_X86
+    auto cpu = get_cpu_features();
+
+    if (cpu->avx512f) {
+        span_fill_impl = (span_fill_impl_t) { .fill = fill_span_avx512, .stream = stream_span_avx512, .fence = fence_sse2 };
+    } else if (cpu->avx2) {
+        span_fill_impl = (span_fill_impl_t) { .fill = fill_span_avx2,   .stream = stream_span_avx2,   .fence = fence_sse2 };
+    } else if (cpu->sse2) {
+        span_fill_impl = (span_fill_impl_t) { .fill = fill_span_sse2,   .stream = stream_span_sse2,   .fence = fence_sse2 };
+    }
+#endif
+}
+
+static const span_fill_impl_t* get_span_fill_impl() {
+    pthread_once(&span_fill_once, select_span_fill_impl);
+    return &span_fill_impl;
+}
+
+
+void fill_span(u32* data, u32 value, u32 count) {
+    get_span_fill_impl()->fill(data, value, count);
+}
+
+void fill_rect(u32* data, u32 stride, u32 width, u32 height, u32 value) {
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    auto impl = get_span_fill_impl();
+
+    u64  size   = (u64) width * height * sizeof(u32);
+    bool stream = size >= FILL_NON_TEMPORAL_THRESHOLD;
+    auto fill   = stream ? impl->stream : impl->fill;
+
+    if (width == stride && (u64) width * height <= UINT32_MAX) {
+        // @Note: full-width rect is one contiguous span.
+        fill(data, value, width * height);
+    } else {
+        for (u32 y = 0; y < height; y++) {
+            fill(data + (u64) y * stride, value, width);
+        }
+    }
+
+    if (stream) {
+        impl->fence();
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "types.h"
+
+//
+// Solid 32-bit span fills. The widest instruction set the cpu supports is picked at runtime (SSE2 -> AVX2 -> AVX-512).
+//
+
+enum {
+    FILL_NON_TEMPORAL_THRESHOLD = 512 * 1024, // @Note: in bytes, fills bigger than this bypass the cache since nobody is going to read them back soon.
+};
+
+void fill_span(u32* data, u32 value, u32 count);
+
+//
+// @Note: stride is in pixels. Large rects are written with non-temporal stores.
+//
+void fill_rect(u32* data, u32 stride, u32 width, u32 height, u32 value);
+
+//
+// @Note: plain loop, kept around as a reference to measure against.
+//
+void fill_span_scalar(u32* data, u32 value, u32 count);
@@ -1,16 +1,33 @@
 #include "temporary_storage.h"
+#include "base.h"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 
+typedef struct temporary_block_t {
+    struct temporary_block_t* previous;
+    u64 base;     // bytes in use in the blocks before this one, for the counters.
+    u32 capacity;
+    u8  data[];
+} temporary_block_t;
+
+static temporary_block_t* allocate_block(u32 capacity) {
+    temporary_block_t* block = malloc(sizeof(temporary_block_t) + capacity);
+    assert(block && "Out of memory for temporary storage");
+
+    *block = (temporary_block_t) { .capacity = capacity };
+    return block;
+}
+
 static temporary_storage_t init_temporary() {
-    static const uint32 TEMPORARY_CAPACITY = 64 * 1024; // 64kb.
+    temporary_block_t* first = allocate_block(TEMPORARY_BLOCK_SIZE);
 
     temporary_storage_t result = {
-        .data     = malloc(TEMPORARY_CAPACITY),
-        .capacity = TEMPORARY_CAPACITY,
-        .mark     = 0,
+        .first = first,
+        .block = first,
+        .mark  = 0,
     };
 
     return result;
@@ -20,38 +37,128 @@ static temporary_storage_t init_temporary() {
 static temporary_storage_t* get_temp() {
     static thread_local temporary_storage_t storage = {};
 
-    if (storage.data == nullptr && storage.capacity == 0) {
+    if (storage.first == nullptr) {
         storage = init_temporary();
     }
 
     return &storage;
 }
 
+// Chains a block that fits at least size bytes after the current one.
+static temporary_block_t* push_block(temporary_storage_t* temp, u32 size) {
+    u32 capacity = max(size, (u32) TEMPORARY_BLOCK_SIZE);
+
+    temporary_block_t* block = temp->spare;
+    if (block && block->capacity >= capacity) {
+        temp->spare = NULL;
+    } else {
+        block = allocate_block(capacity);
+    }
+
+    block->previous = temp->block;
+    block->base     = temp->block->base + temp->mark;
 
-u32 temporary_read_mark() {
+    temp->block = block;
+    temp->mark  = 0;
+    temp->stats.overflows += 1;
+    return block;
+}
+
+// @Note: keeps only the largest block, so a scope that overflows every time doesn't malloc every time.
+static void release_block(temporary_storage_t* temp, temporary_block_t* block) {
+    if (temp->spare == NULL || block->capacity > temp->spare->capacity) {
+        free(temp->spare);
+        temp->spare = block;
+    } else {
+        free(block);
+    }
+}
+
+
+temporary_mark_t temporary_read_mark() {
     auto temp = get_temp();
-    return temp->mark;
+    return (temporary_mark_t) { .block = temp->block, .offset = temp->mark };
 }
 
-void temporary_write_mark(u32 mark) {
+void temporary_write_mark(temporary_mark_t mark) {
     auto temp = get_temp();
-    temp->mark = mark;
+
+    while (temp->block != mark.block) {
+        assert(temp->block != temp->first && "Temporary mark isn't from this thread or was already given back");
+
+        temporary_block_t* block = temp->block;
+        temp->block = block->previous;
+        release_block(temp, block);
+    }
+    temp->mark = mark.offset;
+}
+
+static void update_peaks(temporary_storage_t* temp) {
+    u64 used = temp->block->base + temp->mark;
+    temp->stats.frame_peak = max(temp->stats.frame_peak, used);
+    temp->stats.peak       = max(temp->stats.peak, used);
+}
+
+void* temporary_alloc_uninitialized(u32 size, alignment_info_t alignment) {
+    auto temp  = get_temp();
+    auto block = temp->block;
+
+    uintptr_t data = (uintptr_t) block->data;
+    u64 offset     = align(data + temp->mark, alignment) - data;
+
+    if (offset + size > block->capacity) {
+        block  = push_block(temp, size + alignment.alignment);
+        data   = (uintptr_t) block->data;
+        offset = align(data, alignment) - data;
+    }
+
+    temp->mark = (u32) (offset + size);
+    update_peaks(temp);
+
+    return block->data + offset;
 }
 
 void* temporary_alloc(u32 size, alignment_info_t alignment) {
+    void* result = temporary_alloc_uninitialized(size, alignment);
+    memset(result, 0, size);
+    return result;
+}
+
+bool temporary_extend(void* block, u32 size, u32 new_size) {
     auto temp = get_temp();
 
-    auto ptr     = temp->data + temp->mark;
-    auto aligned = (uint8*) align((uintptr_t) ptr, alignment);
-    memset(aligned, 0, size);
+    u8* end = temp->block->data + temp->mark;
+    if ((u8*) block + size != end) {
+        return false;
+    }
 
-    // @Incomplete: check if we fit, otherwise allocate with malloc??? Log error?
-    temp->mark += (aligned - ptr) + size;
+    u64 mark = (u64) temp->mark - size + new_size;
+    if (mark > temp->block->capacity) {
+        return false;
+    }
 
-    return aligned;
+    temp->mark = (u32) mark;
+    update_peaks(temp);
+    return true;
 }
 
 void temporary_reset() {
     auto temp = get_temp();
-    temp->mark = 0;
+    temporary_write_mark((temporary_mark_t) { .block = temp->first, .offset = 0 });
+
+    temp->stats.last_frame_peak = temp->stats.frame_peak;
+    temp->stats.frame_peak      = 0;
+}
+
+temporary_stats_t temporary_stats() {
+    return get_temp()->stats;
+}
+
+temporary_scope_t temporary_begin_scope() {
+    return (temporary_scope_t) { .mark = temporary_read_mark(), .open = true };
+}
+
+void temporary_end_scope(temporary_scope_t* scope) {
+    temporary_write_mark(scope->mark);
+    scope->open = false;
 }
@@ -3,23 +3,86 @@
 #include "types.h"
 #include "align.h"
 
+//
+// Per thread scratch memory, for strings and arrays that only live until the end of the frame (or of a scope).
+//
+// Allocations bump a mark in a TEMPORARY_BLOCK_SIZE block. When one doesn't fit, another block is chained after the
+// current one, so running out of space costs a malloc instead of writing past the end. Moving the mark back to before
+// a chained block gives the block back, the largest one is kept around for the next overflow.
+//
+// The main loop calls temporary_reset once per iteration, everything tprint returned before that is gone then.
+//
+
+enum {
+    TEMPORARY_BLOCK_SIZE = 64 * 1024,
+};
+
+struct temporary_block_t;
+
+typedef struct {
+    struct temporary_block_t* block;
+    u32 offset;
+} temporary_mark_t;
+
+typedef struct {
+    u64 frame_peak;      // most bytes in use at once since the last temporary_reset.
+    u64 last_frame_peak; // frame_peak when temporary_reset was called last.
+    u64 peak;            // most bytes in use at once ever.
+    u64 overflows;       // blocks chained because the current one was full.
+} temporary_stats_t;
+
 typedef struct temporary_storage_t {
-    uint8* data;
-    uint32 capacity;
-    uint32 mark;
+    struct temporary_block_t* first; // never given back.
+    struct temporary_block_t* block; // where the mark is.
+    u32 mark;
+    struct temporary_block_t* spare; // the largest block given back so far.
+
+    temporary_stats_t stats;
 } temporary_storage_t;
 
+typedef struct {
+    temporary_mark_t mark;
+    bool open;
+} temporary_scope_t;
+
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-u32 temporary_read_mark();
-void temporary_write_mark(u32);
+temporary_mark_t temporary_read_mark();
+void temporary_write_mark(temporary_mark_t mark);
 
 void* temporary_alloc(u32 size, alignment_info_t alignment);
+void* temporary_alloc_uninitialized(u32 size, alignment_info_t alignment);
+
+//
+// Grows or shrinks the last allocation in place, false if block isn't the last allocation or it doesn't fit into its block.
+// @Note: the new part is not zeroed.
+//
+bool temporary_extend(void* block, u32 size, u32 new_size);
+
+//
+// Back to the start of the first block, also ends the frame for the peak counters.
+//
 void temporary_reset();
 
+temporary_stats_t temporary_stats();
+
+temporary_scope_t temporary_begin_scope();
+void temporary_end_scope(temporary_scope_t* scope);
+
 #ifdef __cplusplus
 }
 #endif
+
+//
+// Everything allocated inside of the block is given back after it:
+//
+//     TEMPORARY_SCOPE {
+//         literal line = tprint(...);
+//     }
+//
+// @Note: break or return out of it skips the restore, the memory is given back by the next temporary_reset then.
+//
+#define TEMPORARY_SCOPE for (temporary_scope_t temporary_scope__ = temporary_begin_scope(); temporary_scope__.open; temporary_end_scope(&temporary_scope__))
@@ -0,0 +1,161 @@
+#include "text_run_cache.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void text_run_cache_init(text_run_cache_t* cache, u64 budget) {
+    *cache = (text_run_cache_t) {
+        .budget = budget,
+        .frame  = 1,
+    };
+
+    cache->lru.lru_next = &cache->lru;
+    cache->lru.lru_prev = &cache->lru;
+}
+
+static void unlink_lru(text_run_t* run) {
+    run->lru_prev->lru_next = run->lru_next;
+    run->lru_next->lru_prev = run->lru_prev;
+}
+
+static void push_front_lru(text_run_cache_t* cache, text_run_t* run) {
+    run->lru_prev = &cache->lru;
+    run->lru_next = cache->lru.lru_next;
+    cache->lru.lru_next->lru_prev = run;
+    cache->lru.lru_next = run;
+}
+
+static void remove_run(text_run_cache_t* cache, text_run_t* run) {
+    text_run_t** link = &cache->buckets[run->hash & (TEXT_RUN_BUCKETS - 1)];
+    while (*link != run) {
+        link = &(*link)->next_in_bucket;
+    }
+    *link = run->next_in_bucket;
+
+    unlink_lru(run);
+
+    cache->stats.bytes -= run->bytes;
+    cache->stats.runs  -= 1;
+    free(run);
+}
+
+void text_run_cache_free(text_run_cache_t* cache) {
+    while (cache->lru.lru_next != &cache->lru) {
+        remove_run(cache, cache->lru.lru_next);
+    }
+}
+
+// Evicts from the back of the lru list until there is room, runs of the current frame stay.
+static bool make_room(text_run_cache_t* cache, u64 bytes) {
+    while (cache->stats.bytes + bytes > cache->budget) {
+        text_run_t* oldest = cache->lru.lru_prev;
+        if (oldest == &cache->lru || oldest->last_used_frame == cache->frame) {
+            return false;
+        }
+
+        remove_run(cache, oldest);
+        cache->stats.evictions += 1;
+    }
+
+    return true;
+}
+
+void text_run_cache_set_budget(text_run_cache_t* cache, u64 budget) {
+    cache->budget = budget;
+    make_room(cache, 0);
+}
+
+void text_run_cache_begin_frame(text_run_cache_t* cache) {
+    cache->frame += 1;
+}
+
+
+// FNV-1a.
+static u64 hash_string(const char* string) {
+    u64 hash = 0xcbf29ce484222325ull;
+    for (; *string; string++) {
+        hash ^= (u8) *string;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static text_run_t* find_run(const text_run_cache_t* cache, u64 hash, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string) {
+    for (text_run_t* run = cache->buckets[hash & (TEXT_RUN_BUCKETS - 1)]; run; run = run->next_in_bucket) {
+        if (run->hash != hash || run->font != font || run->size != size) continue;
+        if (run->phase_x != phase_x || run->phase_y != phase_y)          continue;
+
+        if (strcmp(run->string, string) == 0) {
+            return run;
+        }
+    }
+
+    return NULL;
+}
+
+const text_run_t* text_run_find(const text_run_cache_t* cache, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string) {
+    return find_run(cache, hash_string(string), font, size, phase_x, phase_y, string);
+}
+
+text_run_t* text_run_lookup(text_run_cache_t* cache, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string) {
+    text_run_t* run = find_run(cache, hash_string(string), font, size, phase_x, phase_y, string);
+
+    if (run == NULL) {
+        cache->stats.misses += 1;
+        return NULL;
+    }
+
+    cache->stats.hits   += 1;
+    run->last_used_frame = cache->frame;
+
+    unlink_lru(run);
+    push_front_lru(cache, run);
+    return run;
+}
+
+text_run_t* text_run_insert(text_run_cache_t* cache, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string, rectangle_t rect) {
+    assert(rect.w >= 0 && rect.h >= 0);
+
+    size_t length = strlen(string) + 1;
+    u64 bytes     = sizeof(text_run_t) + length + (u64) rect.w * rect.h;
+
+    if (!make_room(cache, bytes)) {
+        cache->stats.rejected += 1;
+        return NULL;
+    }
+
+    text_run_t* run = calloc(1, bytes);
+    char* copy      = (char*) (run + 1);
+    memcpy(copy, string, length);
+
+    *run = (text_run_t) {
+        .hash            = hash_string(string),
+        .font            = font,
+        .size            = size,
+        .phase_x         = phase_x,
+        .phase_y         = phase_y,
+        .string          = copy,
+        .last_used_frame = cache->frame,
+        .bytes           = (u32) bytes,
+        .rect            = rect,
+        .coverage        = {
+            .data   = (u8*) copy + length,
+            .width  = rect.w,
+            .height = rect.h,
+            .stride = rect.w,
+            .format = TEXTURE_FORMAT_A8,
+        },
+    };
+
+    text_run_t** bucket = &cache->buckets[run->hash & (TEXT_RUN_BUCKETS - 1)];
+    run->next_in_bucket = *bucket;
+    *bucket = run;
+
+    push_front_lru(cache, run);
+
+    cache->stats.bytes += bytes;
+    cache->stats.runs  += 1;
+    return run;
+}
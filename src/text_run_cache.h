@@ -0,0 +1,81 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+#include "texture.h"
+
+//
+// Coverage of whole strings, so that redrawing a label that didn't change is one blend per row instead of a quad per glyph.
+//
+// Runs are keyed by (string, font, size, subpixel phase of the pen), color is not part of the key since coverage doesn't depend on it.
+// The cache keeps at most budget bytes of runs and throws away the least recently used ones, but never the ones used by the current frame.
+//
+// @Note: text_run_lookup and text_run_insert change the cache and have to be called from the thread building the frame,
+// text_run_find is read only and is what tile threads use while drawing.
+//
+
+enum {
+    TEXT_RUN_BUCKETS              = 1024, // @Note: power of two.
+    TEXT_RUN_CACHE_DEFAULT_BUDGET = 4 * 1024 * 1024,
+};
+
+typedef struct text_run_t {
+    struct text_run_t* next_in_bucket;
+    struct text_run_t* lru_prev;
+    struct text_run_t* lru_next;
+
+    u64 hash;
+    s32 font;
+    f32 size;
+    f32 phase_x, phase_y;
+    const char* string; // copy, stored right after the run.
+
+    u64 last_used_frame;
+    u32 bytes;
+
+    rectangle_t rect;   // relative to the pen position rounded down.
+    texture_t coverage; // A8, rect.w * rect.h, stored after the string.
+} text_run_t;
+
+typedef struct {
+    u64 hits;
+    u64 misses;
+    u64 evictions;
+    u64 rejected;   // runs that didn't fit into the budget and were drawn glyph by glyph.
+    u64 bytes;
+    u64 runs;
+} text_run_stats_t;
+
+typedef struct text_run_cache_t {
+    text_run_t* buckets[TEXT_RUN_BUCKETS];
+    text_run_t  lru; // sentinel, lru.lru_next is the most recently used run.
+
+    u64 budget;
+    u64 frame;
+
+    text_run_stats_t stats;
+} text_run_cache_t;
+
+void text_run_cache_init(text_run_cache_t* cache, u64 budget);
+void text_run_cache_free(text_run_cache_t* cache);
+void text_run_cache_set_budget(text_run_cache_t* cache, u64 budget);
+
+//
+// Runs used after this call are not evicted until the next one.
+//
+void text_run_cache_begin_frame(text_run_cache_t* cache);
+
+//
+// Finds a run and marks it as used by this frame, counts as a hit or a miss.
+//
+text_run_t* text_run_lookup(text_run_cache_t* cache, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string);
+
+//
+// Allocates a run with zeroed coverage for the caller to fill in, NULL if it doesn't fit into the budget.
+//
+text_run_t* text_run_insert(text_run_cache_t* cache, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string, rectangle_t rect);
+
+//
+// Read only.
+//
+const text_run_t* text_run_find(const text_run_cache_t* cache, s32 font, f32 size, f32 phase_x, f32 phase_y, const char* string);
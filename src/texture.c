@@ -0,0 +1,176 @@
+#include "texture.h"
+#include "base.h"
+#include "blend.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+
+typedef struct {
+    rectangle_t pixels; // destination pixels, clipped.
+
+    // 16.16 texel coordinates at the center of the first pixel, and their step per pixel.
+    s32 u, v;
+    s32 du, dv;
+} texture_mapping_t;
+
+rectangle_t textured_quad_rectangle(textured_quad_t quad) {
+    s32 x0 = (s32) ceilf(quad.x0 - 0.5f);
+    s32 y0 = (s32) ceilf(quad.y0 - 0.5f);
+    s32 x1 = (s32) ceilf(quad.x1 - 0.5f);
+    s32 y1 = (s32) ceilf(quad.y1 - 0.5f);
+
+    if (x1 <= x0 || y1 <= y0) {
+        return (rectangle_t) {};
+    }
+
+    return (rectangle_t) { .x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0 };
+}
+
+static bool map_textured_quad(const texture_t* texture, textured_quad_t quad, rectangle_t clip, texture_mapping_t* mapping) {
+    rectangle_t pixels = intersect_rectangles(textured_quad_rectangle(quad), clip);
+    if (rectangle_is_empty(pixels)) {
+        return false;
+    }
+
+    // @Note: set up once per quad in doubles, so that 1:1 mappings come out exact.
+    f64 du = (f64) (quad.u1 - quad.u0) * texture->width  / (f64) (quad.x1 - quad.x0);
+    f64 dv = (f64) (quad.v1 - quad.v0) * texture->height / (f64) (quad.y1 - quad.y0);
+
+    f64 u = (f64) quad.u0 * texture->width  + (pixels.x + 0.5 - (f64) quad.x0) * du;
+    f64 v = (f64) quad.v0 * texture->height + (pixels.y + 0.5 - (f64) quad.y0) * dv;
+
+    *mapping = (texture_mapping_t) {
+        .pixels = pixels,
+        .u      = (s32) floor(u * 65536.0),
+        .v      = (s32) floor(v * 65536.0),
+        .du     = (s32) lround(du * 65536.0),
+        .dv     = (s32) lround(dv * 65536.0),
+    };
+    return true;
+}
+
+// Texels of a 1:1 row that are all inside of the texture can be used in place.
+static bool row_is_one_to_one(s32 u, s32 du, s32 count, s32 width) {
+    s32 first = u >> 16;
+    return du == (1 << 16) && first >= 0 && first + count <= width;
+}
+
+static s32 texel_index(s32 u, s32 size) {
+    return clamp(u >> 16, 0, size - 1);
+}
+
+// When every texel of the row is inside of the texture the per pixel clamp can be skipped.
+static bool row_is_inside(s32 u, s32 du, s32 count, s32 width) {
+    s64 first = u >> 16;
+    s64 last  = ((s64) u + (s64) du * (count - 1)) >> 16;
+    return min(first, last) >= 0 && max(first, last) < width;
+}
+
+static u8 mul_div255(u32 a, u32 b) {
+    u32 t = a * b + 128;
+    return (u8) ((t + (t >> 8)) >> 8);
+}
+
+static void draw_a8_row(u32* target, const u8* row, s32 width, s32 u, s32 du, s32 count, u32 color) {
+    if (row_is_one_to_one(u, du, count, width)) {
+        blend_span_coverage(target, color, row + (u >> 16), (u32) count);
+        return;
+    }
+
+    // @Note: gather coverage in chunks and blend each chunk as one span.
+    u8 coverage[256];
+
+    for (s32 chunk = 0; chunk < count; chunk += (s32) static_array_size(coverage)) {
+        s32 chunk_count = min(count - chunk, (s32) static_array_size(coverage));
+
+        if (row_is_inside(u, du, chunk_count, width)) {
+            for (s32 i = 0; i < chunk_count; i++) {
+                coverage[i] = row[u >> 16];
+                u += du;
+            }
+        } else {
+            for (s32 i = 0; i < chunk_count; i++) {
+                coverage[i] = row[texel_index(u, width)];
+                u += du;
+            }
+        }
+
+        blend_span_coverage(target + chunk, color, coverage, (u32) chunk_count);
+    }
+}
+
+static void draw_xrgb_row(u32* target, const u32* row, s32 width, s32 u, s32 du, s32 count, u8 alpha) {
+    if (alpha == 255 && row_is_one_to_one(u, du, count, width)) {
+        memcpy(target, row + (u >> 16), (size_t) count * sizeof(u32));
+        return;
+    }
+
+    for (s32 i = 0; i < count; i++) {
+        u32 texel = row[texel_index(u, width)];
+        target[i] = alpha == 255 ? texel | 0xff000000 : blend_pixel(target[i], texel, alpha);
+        u += du;
+    }
+}
+
+static void draw_argb_row(u32* target, const u32* row, s32 width, s32 u, s32 du, s32 count, u8 alpha) {
+    for (s32 i = 0; i < count; i++) {
+        u32 texel = row[texel_index(u, width)];
+        u8  a     = mul_div255(texel >> 24, alpha);
+
+        if (a) {
+            target[i] = blend_pixel(target[i], texel, a);
+        }
+        u += du;
+    }
+}
+
+void draw_textured_quad(buffer_t* buffer, const texture_t* texture, textured_quad_t quad, u32 color, rectangle_t clip) {
+    texture_mapping_t mapping;
+    if (!map_textured_quad(texture, quad, clip, &mapping)) {
+        return;
+    }
+
+    rectangle_t pixels = mapping.pixels;
+    u8 alpha = (u8) (color >> 24);
+
+    s32 v = mapping.v;
+    for (s32 y = pixels.y; y < pixels.y + pixels.h; y++, v += mapping.dv) {
+        const u8* row = texture->data + (size_t) texel_index(v, texture->height) * texture->stride;
+        u32* target   = buffer->data + (y * buffer->width + pixels.x);
+
+        switch (texture->format) {
+            case TEXTURE_FORMAT_A8:       draw_a8_row(target, row, texture->width, mapping.u, mapping.du, pixels.w, color); break;
+            case TEXTURE_FORMAT_XRGB8888: draw_xrgb_row(target, (const u32*) row, texture->width, mapping.u, mapping.du, pixels.w, alpha); break;
+            case TEXTURE_FORMAT_ARGB8888: draw_argb_row(target, (const u32*) row, texture->width, mapping.u, mapping.du, pixels.w, alpha); break;
+        }
+    }
+}
+
+void accumulate_textured_quad(texture_t* target, const texture_t* texture, textured_quad_t quad) {
+    assert(target->format == TEXTURE_FORMAT_A8 && texture->format == TEXTURE_FORMAT_A8);
+
+    rectangle_t bounds = { .x = 0, .y = 0, .w = target->width, .h = target->height };
+
+    texture_mapping_t mapping;
+    if (!map_textured_quad(texture, quad, bounds, &mapping)) {
+        return;
+    }
+
+    rectangle_t pixels = mapping.pixels;
+
+    s32 v = mapping.v;
+    for (s32 y = pixels.y; y < pixels.y + pixels.h; y++, v += mapping.dv) {
+        const u8* row = texture->data + (size_t) texel_index(v, texture->height) * texture->stride;
+        u8* coverage  = target->data + (size_t) y * target->stride + pixels.x;
+
+        s32 u = mapping.u;
+        for (s32 i = 0; i < pixels.w; i++) {
+            u32 a = coverage[i];
+            u32 b = row[texel_index(u, texture->width)];
+            coverage[i] = (u8) (a + b - mul_div255(a, b));
+            u += mapping.du;
+        }
+    }
+}
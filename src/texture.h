@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+
+//
+// Bitmaps that get drawn into the framebuffer: glyph atlas pages, text runs, icons and cached panels.
+//
+
+typedef enum {
+    TEXTURE_FORMAT_A8 = 0,     // coverage, drawn in the color of the quad.
+    TEXTURE_FORMAT_XRGB8888,   // opaque, same layout as the framebuffer.
+    TEXTURE_FORMAT_ARGB8888,   // not premultiplied.
+} texture_format_t;
+
+typedef struct {
+    u8* data;
+    s32 width;
+    s32 height;
+    s32 stride; // @Note: in bytes.
+    texture_format_t format;
+} texture_t;
+
+//
+// Screen rect and the part of the texture mapped onto it, uv in [0, 1].
+// A pixel is drawn when its center is inside of the rect, so integer rects are half open: [x0, x1) x [y0, y1).
+//
+typedef struct {
+    f32 x0, y0, x1, y1;
+    f32 u0, v0, u1, v1;
+} textured_quad_t;
+
+rectangle_t textured_quad_rectangle(textured_quad_t quad);
+
+//
+// Nearest sampling with texel coordinates stepped in 16.16 fixed point, texels outside of the texture are clamped to its edge.
+// Quads that map texels 1:1 horizontally are drawn straight from the texture rows.
+//
+// @Note: for A8 the color (and its alpha) is applied to the coverage. For the rgb formats only the alpha of color is used, to fade the whole quad.
+// Only pixels inside of clip are written, clip has to be inside of the buffer.
+//
+void draw_textured_quad(buffer_t* buffer, const texture_t* texture, textured_quad_t quad, u32 color, rectangle_t clip);
+
+//
+// Adds coverage of an A8 quad to an A8 target as 1 - (1-a)(1-b), which is what blending the quads one after another would do.
+//
+void accumulate_textured_quad(texture_t* target, const texture_t* texture, textured_quad_t quad);
@@ -0,0 +1,205 @@
+#include "tile_renderer.h"
+#include "base.h"
+
+#include <assert.h>
+#include <unistd.h>
+
+
+static void render_tiles(tile_renderer_t* renderer) {
+    buffer_t* buffer = renderer->buffer;
+    s32 tile_count   = renderer->tiles_x * renderer->tiles_y;
+
+    while (true) {
+        s32 tile = atomic_fetch_add(&renderer->next_tile, 1);
+        if (tile >= tile_count) {
+            break;
+        }
+
+        u32 first = renderer->bin_offsets[tile];
+        u32 last  = renderer->bin_offsets[tile + 1];
+        if (first == last) {
+            continue;
+        }
+
+        rectangle_t clip = {
+            .x = (tile % renderer->tiles_x) * TILE_SIZE,
+            .y = (tile / renderer->tiles_x) * TILE_SIZE,
+            .w = TILE_SIZE,
+            .h = TILE_SIZE,
+        };
+        clip = intersect_rectangles(clip, buffer_rectangle(buffer));
+
+        for (u32 i = first; i < last; i++) {
+            u32 command = renderer->bin_commands[i];
+            draw_command(buffer, &renderer->commands[command], intersect_rectangles(clip, renderer->bounds[command]));
+        }
+    }
+}
+
+static void* tile_worker(void* data) {
+    tile_renderer_t* renderer = data;
+
+    u64 seen = 0;
+
+    pthread_mutex_lock(&renderer->mutex);
+    while (true) {
+        while (renderer->generation == seen && !renderer->quit) {
+            pthread_cond_wait(&renderer->work_ready, &renderer->mutex);
+        }
+
+        if (renderer->quit) {
+            break;
+        }
+
+        seen = renderer->generation;
+        pthread_mutex_unlock(&renderer->mutex);
+
+        render_tiles(renderer);
+
+        pthread_mutex_lock(&renderer->mutex);
+        renderer->busy_workers -= 1;
+        if (renderer->busy_workers == 0) {
+            pthread_cond_signal(&renderer->work_done);
+        }
+    }
+    pthread_mutex_unlock(&renderer->mutex);
+
+    return NULL;
+}
+
+void tile_renderer_init(tile_renderer_t* renderer, s32 thread_count) {
+    *renderer = (tile_renderer_t) {};
+
+    if (thread_count <= 0) {
+        thread_count = (s32) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    thread_count = clamp(thread_count - 1, 0, MAX_TILE_THREADS);
+
+    pthread_mutex_init(&renderer->mutex, NULL);
+    pthread_cond_init(&renderer->work_ready, NULL);
+    pthread_cond_init(&renderer->work_done, NULL);
+    arena_init(&renderer->arena, 64 * 1024);
+
+    for (s32 i = 0; i < thread_count; i++) {
+        if (pthread_create(&renderer->threads[i], NULL, tile_worker, renderer) != 0) {
+            break;
+        }
+        renderer->thread_count += 1;
+    }
+}
+
+void tile_renderer_destroy(tile_renderer_t* renderer) {
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->quit = true;
+    pthread_cond_broadcast(&renderer->work_ready);
+    pthread_mutex_unlock(&renderer->mutex);
+
+    for (s32 i = 0; i < renderer->thread_count; i++) {
+        pthread_join(renderer->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&renderer->work_done);
+    pthread_cond_destroy(&renderer->work_ready);
+    pthread_mutex_destroy(&renderer->mutex);
+    arena_free(&renderer->arena);
+}
+
+static void bin_commands(tile_renderer_t* renderer, const rectangle_t* bounds, s32 count) {
+    s32 tile_count = renderer->tiles_x * renderer->tiles_y;
+
+    u64 binned = 0;
+    for (s32 i = 0; i < count; i++) {
+        if (rectangle_is_empty(bounds[i])) continue;
+
+        s32 tx0 = bounds[i].x / TILE_SIZE;
+        s32 ty0 = bounds[i].y / TILE_SIZE;
+        s32 tx1 = (bounds[i].x + bounds[i].w - 1) / TILE_SIZE;
+        s32 ty1 = (bounds[i].y + bounds[i].h - 1) / TILE_SIZE;
+        binned += (u64) (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    }
+
+    // @Note: the arena grows in place, offsets have to start at zero for counting, commands are all written below.
+    arena_reset(&renderer->arena);
+    renderer->bin_offsets  = arena_push_array(&renderer->arena, u32, tile_count + 1);
+    renderer->bin_commands = arena_push_array_uninitialized(&renderer->arena, u32, binned);
+
+    // Count commands per tile, prefix sum into offsets, then fill in submission order.
+    u32* offsets = renderer->bin_offsets;
+
+    for (s32 i = 0; i < count; i++) {
+        if (rectangle_is_empty(bounds[i])) continue;
+
+        for (s32 ty = bounds[i].y / TILE_SIZE; ty <= (bounds[i].y + bounds[i].h - 1) / TILE_SIZE; ty++) {
+            for (s32 tx = bounds[i].x / TILE_SIZE; tx <= (bounds[i].x + bounds[i].w - 1) / TILE_SIZE; tx++) {
+                offsets[ty * renderer->tiles_x + tx + 1] += 1;
+            }
+        }
+    }
+
+    for (s32 t = 0; t < tile_count; t++) {
+        offsets[t + 1] += offsets[t];
+    }
+
+    for (s32 i = 0; i < count; i++) {
+        if (rectangle_is_empty(bounds[i])) continue;
+
+        for (s32 ty = bounds[i].y / TILE_SIZE; ty <= (bounds[i].y + bounds[i].h - 1) / TILE_SIZE; ty++) {
+            for (s32 tx = bounds[i].x / TILE_SIZE; tx <= (bounds[i].x + bounds[i].w - 1) / TILE_SIZE; tx++) {
+                s32 tile = ty * renderer->tiles_x + tx;
+                renderer->bin_commands[offsets[tile]++] = (u32) i;
+            }
+        }
+    }
+
+    // Filling moved every offset to the start of the next tile, shift them back.
+    for (s32 t = tile_count; t > 0; t--) {
+        offsets[t] = offsets[t - 1];
+    }
+    offsets[0] = 0;
+}
+
+void tile_renderer_execute(tile_renderer_t* renderer, buffer_t* buffer, const command_t* commands, const rectangle_t* bounds, s32 count) {
+    if (count == 0) {
+        return;
+    }
+
+    u64 pixels = 0;
+    for (s32 i = 0; i < count; i++) {
+        if (!rectangle_is_empty(bounds[i])) {
+            pixels += (u64) bounds[i].w * bounds[i].h;
+        }
+    }
+
+    if (renderer->thread_count == 0 || pixels < TILE_RENDERER_SERIAL_PIXELS) {
+        for (s32 i = 0; i < count; i++) {
+            if (!rectangle_is_empty(bounds[i])) {
+                draw_command(buffer, &commands[i], bounds[i]);
+            }
+        }
+        return;
+    }
+
+    renderer->buffer   = buffer;
+    renderer->commands = commands;
+    renderer->bounds   = bounds;
+    renderer->tiles_x  = (buffer->width  + TILE_SIZE - 1) / TILE_SIZE;
+    renderer->tiles_y  = (buffer->height + TILE_SIZE - 1) / TILE_SIZE;
+    atomic_store(&renderer->next_tile, 0);
+
+    bin_commands(renderer, bounds, count);
+
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->busy_workers = renderer->thread_count;
+    renderer->generation  += 1;
+    pthread_cond_broadcast(&renderer->work_ready);
+    pthread_mutex_unlock(&renderer->mutex);
+
+    render_tiles(renderer);
+
+    pthread_mutex_lock(&renderer->mutex);
+    while (renderer->busy_workers > 0) {
+        pthread_cond_wait(&renderer->work_done, &renderer->mutex);
+    }
+    pthread_mutex_unlock(&renderer->mutex);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+#include "memory_arena.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+//
+// Bins commands into screen tiles by their bounds and rasterizes the tiles on a fixed pool of threads.
+// Every tile is drawn by exactly one thread, clipped to the tile, with its commands in submission order,
+// so the result is the same as drawing all of the commands serially.
+//
+
+enum {
+    TILE_SIZE        = 64,
+    MAX_TILE_THREADS = 64,
+
+    TILE_RENDERER_SERIAL_PIXELS = 128 * 128, // @Note: below this many pixels of work waking up the workers costs more than it saves.
+};
+
+typedef struct tile_renderer_t {
+    pthread_t threads[MAX_TILE_THREADS];
+    s32 thread_count; // @Note: workers only, the thread calling tile_renderer_execute helps too.
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  work_ready;
+    pthread_cond_t  work_done;
+    u64  generation;
+    s32  busy_workers;
+    bool quit;
+
+    // Current frame.
+    buffer_t*          buffer;
+    const command_t*   commands;
+    const rectangle_t* bounds;
+    s32 tiles_x;
+    s32 tiles_y;
+    u32* bin_offsets;  // tiles_x*tiles_y + 1 entries, commands of tile i are bin_commands[bin_offsets[i] .. bin_offsets[i+1]].
+    u32* bin_commands;
+    atomic_int next_tile;
+
+    memory_arena_t arena; // bins, reset every frame.
+} tile_renderer_t;
+
+//
+// @Note: thread_count == 0 picks the number of online cpus.
+//
+void tile_renderer_init(tile_renderer_t* renderer, s32 thread_count);
+void tile_renderer_destroy(tile_renderer_t* renderer);
+
+//
+// @Note: bounds are command_bounds of every command, or a part of them. Nothing outside of the bounds of a command is drawn.
+//
+void tile_renderer_execute(tile_renderer_t* renderer, buffer_t* buffer, const command_t* commands, const rectangle_t* bounds, s32 count);
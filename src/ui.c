@@ -0,0 +1,216 @@
+#include "ui.h"
+#include "base.h"
+
+#include <assert.h>
+
+
+void ui_init(ui_t* ui) {
+    ui->count  = 0;
+    ui->width  = 0;
+    ui->height = 0;
+
+    ui->nodes[ui->count++] = (ui_node_t) {
+        .kind         = UI_NODE_ROOT,
+        .parent       = -1,
+        .first_child  = -1,
+        .next_sibling = -1,
+    };
+}
+
+s32 ui_add(ui_t* ui, s32 parent, ui_node_t node) {
+    assert(ui->count < MAX_UI_NODES && "Too many ui nodes");
+    assert(parent >= 0 && parent < ui->count);
+
+    s32 id = ui->count++;
+
+    node.parent       = parent;
+    node.first_child  = -1;
+    node.next_sibling = -1;
+    ui->nodes[id]     = node;
+
+    s32* link = &ui->nodes[parent].first_child;
+    while (*link != -1 && ui->nodes[*link].z <= node.z) {
+        link = &ui->nodes[*link].next_sibling;
+    }
+    ui->nodes[id].next_sibling = *link;
+    *link = id;
+
+    ui_mark_dirty(ui, id);
+    ui->width = 0; // @Note: the rect of the new node and the subtree rects of its ancestors are unknown.
+    return id;
+}
+
+void ui_mark_dirty(ui_t* ui, s32 id) {
+    ui->nodes[id].dirty = true;
+
+    for (s32 parent = ui->nodes[id].parent; parent != -1 && !ui->nodes[parent].subtree_dirty; parent = ui->nodes[parent].parent) {
+        ui->nodes[parent].subtree_dirty = true;
+    }
+}
+
+void ui_set_color(ui_t* ui, s32 id, u32 color) {
+    if (ui->nodes[id].color != color) {
+        ui->nodes[id].color = color;
+        ui_mark_dirty(ui, id);
+    }
+}
+
+bool ui_is_dirty(const ui_t* ui) {
+    return ui->nodes[UI_ROOT].dirty || ui->nodes[UI_ROOT].subtree_dirty;
+}
+
+
+static bool node_contains(const ui_node_t* node, f32 x, f32 y) {
+    return x > node->x && x < node->x + node->w && y > node->y && y < node->y + node->h;
+}
+
+// Last tab in drawing order under the point, which is the one on top.
+static s32 find_top_tab(const ui_t* ui, s32 id, f32 x, f32 y) {
+    s32 result = -1;
+
+    const ui_node_t* node = &ui->nodes[id];
+    if (node->kind == UI_NODE_TAB && node_contains(node, x, y)) {
+        result = id;
+    }
+
+    for (s32 child = node->first_child; child != -1; child = ui->nodes[child].next_sibling) {
+        s32 found = find_top_tab(ui, child, x, y);
+        if (found != -1) {
+            result = found;
+        }
+    }
+
+    return result;
+}
+
+bool ui_update_hover(ui_t* ui, f32 x, f32 y) {
+    s32 hovered = find_top_tab(ui, UI_ROOT, x, y);
+    bool changed = false;
+
+    for (s32 id = 0; id < ui->count; id++) {
+        ui_node_t* node = &ui->nodes[id];
+        if (node->kind != UI_NODE_TAB || node->hovered == (id == hovered)) continue;
+
+        node->hovered = id == hovered;
+        ui_mark_dirty(ui, id);
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+static command_t node_command(const ui_node_t* node) {
+    switch (node->kind) {
+        case UI_NODE_PANEL:
+        case UI_NODE_TAB: {
+            u32 color = node->hovered && node->hover_color ? node->hover_color : node->color;
+            return (command_t) {
+                .type = COMMAND_TYPE_DRAW_BOX,
+                .box  = { .x = node->x, .y = node->y, .w = node->w, .h = node->h, .color = color },
+            };
+        }
+
+        case UI_NODE_LABEL:
+            return (command_t) {
+                .type = COMMAND_TYPE_DRAW_TEXT,
+                .text = { .x = node->x, .y = node->y, .string = node->text, .color = node->color },
+            };
+
+        case UI_NODE_MARKER:
+            return (command_t) {
+                .type   = COMMAND_TYPE_DRAW_CIRCLE,
+                .circle = { .x = node->x, .y = node->y, .r = node->r, .color = node->color },
+            };
+
+        case UI_NODE_ROOT:
+            break;
+    }
+
+    return (command_t) { .type = COMMAND_TYPE_NONE };
+}
+
+static rectangle_t union_of(rectangle_t a, rectangle_t b) {
+    if (rectangle_is_empty(a)) return b;
+    if (rectangle_is_empty(b)) return a;
+
+    s32 x0 = min(a.x, b.x);
+    s32 y0 = min(a.y, b.y);
+    s32 x1 = max(a.x + a.w, b.x + b.w);
+    s32 y1 = max(a.y + a.h, b.y + b.h);
+    return (rectangle_t) { .x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0 };
+}
+
+static rectangle_t update_node_rects(ui_t* ui, buffer_t* buffer, s32 id) {
+    ui_node_t* node = &ui->nodes[id];
+
+    command_t command = node_command(node);
+    node->rect = command.type == COMMAND_TYPE_NONE ? (rectangle_t) {} : command_bounds(buffer, &command);
+
+    rectangle_t subtree = node->rect;
+    for (s32 child = node->first_child; child != -1; child = ui->nodes[child].next_sibling) {
+        subtree = union_of(subtree, update_node_rects(ui, buffer, child));
+    }
+
+    node->subtree = subtree;
+    return subtree;
+}
+
+void ui_update_rects(ui_t* ui, buffer_t* buffer) {
+    if (ui->width == buffer->width && ui->height == buffer->height) {
+        return;
+    }
+
+    update_node_rects(ui, buffer, UI_ROOT);
+    ui->width  = buffer->width;
+    ui->height = buffer->height;
+}
+
+
+static void collect_damage(ui_t* ui, s32 id, region_t* damage) {
+    ui_node_t* node = &ui->nodes[id];
+
+    if (node->dirty) {
+        region_add(damage, node->rect);
+    }
+
+    if (node->subtree_dirty) {
+        for (s32 child = node->first_child; child != -1; child = ui->nodes[child].next_sibling) {
+            collect_damage(ui, child, damage);
+        }
+    }
+
+    node->dirty         = false;
+    node->subtree_dirty = false;
+}
+
+void ui_collect_damage(ui_t* ui, region_t* damage) {
+    collect_damage(ui, UI_ROOT, damage);
+}
+
+void ui_clear_dirty(ui_t* ui) {
+    for (s32 id = 0; id < ui->count; id++) {
+        ui->nodes[id].dirty         = false;
+        ui->nodes[id].subtree_dirty = false;
+    }
+}
+
+static void add_node_commands(const ui_t* ui, s32 id, command_buffer_t* commands, rectangle_t clip) {
+    const ui_node_t* node = &ui->nodes[id];
+
+    if (rectangle_is_empty(intersect_rectangles(node->subtree, clip))) {
+        return;
+    }
+
+    if (!rectangle_is_empty(intersect_rectangles(node->rect, clip))) {
+        add_command(commands, node_command(node));
+    }
+
+    for (s32 child = node->first_child; child != -1; child = ui->nodes[child].next_sibling) {
+        add_node_commands(ui, child, commands, clip);
+    }
+}
+
+void ui_add_commands(const ui_t* ui, command_buffer_t* commands, rectangle_t clip) {
+    add_node_commands(ui, UI_ROOT, commands, clip);
+}
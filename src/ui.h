@@ -0,0 +1,94 @@
+#pragma once
+
+#include "types.h"
+#include "render.h"
+#include "region.h"
+
+//
+// Retained scene: every box, label and marker on screen is a node that stays around between frames.
+//
+// Nodes are drawn in tree order, parents before their children and siblings by z, so a child is always on top of its parent.
+// Each node caches its screen rect, and the rect of its whole subtree so that walks can skip subtrees outside of a clip.
+//
+// Changing a node marks it dirty and its ancestors as having a dirty subtree. ui_collect_damage walks only down those paths,
+// and redrawing the damage is emitting the nodes that intersect it, clipped to it.
+//
+// @Note: node ids are indices and stay valid for the lifetime of the ui, nodes are never removed.
+//
+
+enum {
+    MAX_UI_NODES = 256,
+    UI_ROOT      = 0,
+};
+
+typedef enum {
+    UI_NODE_ROOT = 0, // doesn't draw anything.
+    UI_NODE_PANEL,    // box.
+    UI_NODE_TAB,      // box that changes color while hovered.
+    UI_NODE_LABEL,    // text at x, y.
+    UI_NODE_MARKER,   // circle at x, y with radius r.
+} ui_node_kind_t;
+
+typedef struct {
+    ui_node_kind_t kind;
+    s32 z;
+
+    f32 x, y, w, h; // world units, same as the commands.
+    f32 r;
+    u32 color;
+    u32 hover_color;
+    const char* text; // @Note: not owned, has to outlive the ui.
+
+    // Filled in by the ui.
+    s32 parent;
+    s32 first_child;
+    s32 next_sibling;
+
+    rectangle_t rect;    // pixels of the node itself.
+    rectangle_t subtree; // pixels of the node and all of its descendants.
+
+    bool hovered;
+    bool dirty;         // the node changed since it was last drawn.
+    bool subtree_dirty; // a descendant changed.
+} ui_node_t;
+
+typedef struct ui_t {
+    ui_node_t nodes[MAX_UI_NODES];
+    s32 count;
+
+    s32 width, height; // buffer size the cached rects are for, 0 when they have to be recomputed.
+} ui_t;
+
+void ui_init(ui_t* ui);
+
+//
+// Adds a node under parent, after the siblings with a z that's not greater than its own. Returns its id.
+//
+s32 ui_add(ui_t* ui, s32 parent, ui_node_t node);
+
+void ui_set_color(ui_t* ui, s32 id, u32 color);
+void ui_mark_dirty(ui_t* ui, s32 id);
+
+//
+// Hovers the topmost tab under the point, in world units. Returns true when a tab changed.
+//
+bool ui_update_hover(ui_t* ui, f32 x, f32 y);
+
+bool ui_is_dirty(const ui_t* ui);
+
+//
+// Recomputes the cached rects when the buffer size changed.
+// @Note: calls command_bounds, so it has to be called after render_begin_frame of the frame using them.
+//
+void ui_update_rects(ui_t* ui, buffer_t* buffer);
+
+//
+// Adds the rects of dirty nodes to damage and clears the dirty bits, only subtrees with something dirty in them are visited.
+//
+void ui_collect_damage(ui_t* ui, region_t* damage);
+void ui_clear_dirty(ui_t* ui);
+
+//
+// Adds draw commands for the nodes that intersect clip, in drawing order.
+//
+void ui_add_commands(const ui_t* ui, command_buffer_t* commands, rectangle_t clip);